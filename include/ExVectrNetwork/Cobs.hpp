@@ -0,0 +1,37 @@
+#ifndef EXVECTRNETWORK_COBS_HPP_
+#define EXVECTRNETWORK_COBS_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace VCTR::network::cobs {
+
+/// Byte that never appears in encoded data. Used to delimit frames.
+static constexpr uint8_t delimiter = 0x00;
+
+/// @returns the largest size data of the given size can have once encoded.
+constexpr size_t maxEncodedSize(size_t size) { return size + size / 254 + 1; }
+
+/**
+ * @brief Encodes data with Consistent Overhead Byte Stuffing, so it contains
+ * no zero bytes. The delimiter is not added.
+ * @param data Data to encode.
+ * @param size Number of bytes.
+ * @param buffer Output. Must fit maxEncodedSize(size) bytes. May not overlap
+ * with data.
+ * @returns the number of encoded bytes.
+ */
+size_t encode(const uint8_t *data, size_t size, uint8_t *buffer);
+
+/**
+ * @brief Decodes COBS encoded data without the delimiter.
+ * @param data Encoded data.
+ * @param size Number of encoded bytes.
+ * @param buffer Output. Must fit size bytes. May be the same as data.
+ * @returns the number of decoded bytes. 0 if the data is not valid.
+ */
+size_t decode(const uint8_t *data, size_t size, uint8_t *buffer);
+
+} // namespace VCTR::network::cobs
+
+#endif
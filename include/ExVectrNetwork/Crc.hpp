@@ -0,0 +1,58 @@
+#ifndef EXVECTRNETWORK_CRC_HPP_
+#define EXVECTRNETWORK_CRC_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace VCTR::network::crc {
+
+/// Initial value of the CRC-16/CCITT-FALSE register.
+static constexpr uint16_t crc16Init = 0xFFFF;
+
+/**
+ * @brief Calculates the CRC-16/CCITT-FALSE (poly 0x1021, no reflection, no
+ * final xor) of the given data.
+ * @details Table driven and processes 8 bytes per step (slice-by-8). Pass the
+ * result of a previous call as crc to continue over data in multiple pieces.
+ * Appending the result big endian to the data gives a CRC of 0 over
+ * everything, which is how frames are checked.
+ * @param data Data to calculate the CRC of.
+ * @param size Number of bytes.
+ * @param crc Value to continue from.
+ * @returns the new CRC value.
+ */
+uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc = crc16Init);
+
+/**
+ * @brief Calculates the CRC-32 (IEEE 802.3, same as zlib) of the given data.
+ * @details Streaming: pass the result of a previous call as crc to continue
+ * with the next piece of data. Start with 0.
+ * @param data Data to calculate the CRC of.
+ * @param size Number of bytes.
+ * @param crc CRC of the data in front of this piece.
+ * @returns the CRC of all data so far.
+ */
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0);
+
+/**
+ * @brief Moves a CRC-32 as if size zero bytes were appended to its data,
+ * without touching any data. Costs O(log size).
+ * @details The CRC of data made of pieces A, B, C... is the xor of the CRC of
+ * each piece shifted by the number of bytes behind it. So pieces can be added
+ * in any order as long as their position is known.
+ */
+uint32_t crc32Shift(uint32_t crc, size_t size);
+
+/**
+ * @brief Calculates the CRC-32 of A followed by B from the CRCs of A and B.
+ * @param crcA CRC of the first piece.
+ * @param crcB CRC of the second piece.
+ * @param sizeB Number of bytes in the second piece.
+ */
+inline uint32_t crc32Combine(uint32_t crcA, uint32_t crcB, size_t sizeB) {
+  return crc32Shift(crcA, sizeB) ^ crcB;
+}
+
+} // namespace VCTR::network::crc
+
+#endif
@@ -5,83 +5,145 @@
 #include "ExVectrCore/list_array.hpp"
 #include "ExVectrCore/print.hpp"
 
-namespace VCTR::network {
+#include "ExVectrNetwork/PacketBuffer.hpp"
+#include "ExVectrNetwork/PacketChain.hpp"
+#include "ExVectrNetwork/PacketMetadata.hpp"
+#include "ExVectrNetwork/PacketView.hpp"
+#include "ExVectrNetwork/Priority.hpp"
 
-class PacketHeaderI;
+namespace VCTR::network {
 
 /**
  * @brief General packet for all layers below the transport layer.
  * @details Each layer appends/pops its own header to the payload.
  */
 class DataPacket {
-  friend PacketHeaderI;
-
 public:
+  /// Tailroom reserved by default. Enough for the network header and the
+  /// transport trailer to be added without reallocating the payload.
+  static constexpr size_t defaultTailroom = 16;
+
   DataPacket() = default;
 
-  DataPacket(const Core::ListArray<uint8_t> &other) : payload(other) {}
+  /**
+   * @param payloadSize Number of payload bytes. Content is undefined.
+   * @param tailroom Bytes to reserve behind the payload for headers.
+   */
+  explicit DataPacket(size_t payloadSize, size_t tailroom = defaultTailroom)
+      : payload(payloadSize, tailroom) {}
+
+  DataPacket(const Core::ListArray<uint8_t> &other)
+      : payload(other.getPtr(), other.size(), defaultTailroom) {}
 
   /// The data carried by this packet.
-  Core::ListArray<uint8_t> payload;
+  PacketBuffer payload;
 
   /// The time when this packet was created for transmission or received.
   int64_t timestamp = 0;
+
+  /// Queue the datalinks transmit this packet from.
+  Priority priority = Priority::NORMAL;
+
+  /// Receive information. Only set on received packets.
+  PacketMetadata metadata;
 };
 
 /**
- * @brief defines the needed functions for a packet header.
- * @note The Header is always appended to the back of the payload.
+ * @brief Helper functions for adding and removing a header to a packet.
+ * @details The header class derives from this with itself as the template
+ * parameter and provides:
+ *  - static constexpr size_t headerSize
+ *  - void serialize(uint8_t *buffer) const
+ *  - bool deserialize(const uint8_t *buffer)
+ * Headers that protect the payload, for example with a checksum, can also
+ * provide:
+ *  - void seal(uint8_t *buffer, const PacketView *payload, size_t numParts)
+ *    const. Called after serialize() with the payload in front of the header.
+ *  - bool check(const uint8_t *frame, size_t size) const. Called before
+ *    deserialize() with the whole frame. Returning false rejects it.
+ * Nothing is virtual and the size is known at compile time, so the calls are
+ * inlined. Use layout::Field to describe the bytes of the header.
+ * @note The Header is always appended to the back of the payload. If the
+ * payload has enough tailroom this does not reallocate.
+ * @tparam HEADER The deriving header class.
  */
-class PacketHeaderI {
-public:
-  virtual ~PacketHeaderI() {}
-
-protected:
-  /**
-   * @brief Serializes the packet header into a list of bytes.
-   */
-  virtual void serialize(uint8_t *buffer) const = 0;
-  /**
-   * @brief Deserializes the packet header from a list of bytes.
-   */
-  virtual bool deserialize(const uint8_t *buffer) = 0;
-
+template <typename HEADER> class PacketHeader {
 public:
   /**
    * @brief Get the size of the header in bytes. Used to know how many bytes
    * to extract from the payload when popping the header.
    */
-  virtual size_t getHeaderSize() const = 0;
+  static constexpr size_t getHeaderSize() { return HEADER::headerSize; }
 
-  /// Helper functions for adding and removing headers from the payload.
+  /// adds the header to the back of the packet. Returns false if no storage
+  /// could be allocated.
+  bool addHeader(DataPacket &packet) const {
+    auto buffer = packet.payload.push(HEADER::headerSize);
+    if (buffer == nullptr)
+      return false;
+    self().serialize(buffer);
+    PacketView payload(packet.payload.getPtr(),
+                       packet.payload.size() - HEADER::headerSize);
+    self().seal(buffer, &payload, 1);
+    return true;
+  }
+
+  /// adds the header to the back of the chain. Returns false if it is full.
+  bool addHeader(PacketChain &chain) const {
+    // Pushing may grow the last fragment, so the payload is taken before.
+    PacketView payload[PacketChain::maxFragments];
+    auto numParts = chain.getNumFragments();
+    for (size_t i = 0; i < numParts; i++)
+      payload[i] = chain.getFragment(i);
 
-  /// adds the header to the back of the packet.
-  void addHeader(DataPacket &packet) {
-    packet.payload.setSize(packet.payload.size() + getHeaderSize());
-    serialize(packet.payload.getPtr() + packet.payload.size() -
-              getHeaderSize());
+    auto buffer = chain.push(HEADER::headerSize);
+    if (buffer == nullptr)
+      return false;
+    self().serialize(buffer);
+    self().seal(buffer, payload, numParts);
+    return true;
   }
 
   /// Removes the header type from the back of the payload.
-  void popHeader(DataPacket &packet) {
-    const auto headerSize = getHeaderSize();
-    if (packet.payload.size() < headerSize) {
+  void popHeader(DataPacket &packet) const {
+    if (packet.payload.size() < HEADER::headerSize) {
       LOG_MSG("Not enough data to pop header! \n");
       return;
     }
-    packet.payload.popDiscard(headerSize);
-    return;
+    packet.payload.popDiscard(HEADER::headerSize);
   }
 
+  /// Reads the header from the back of the packet.
   bool fromPacket(const DataPacket &packet) {
-    if (packet.payload.size() < getHeaderSize()) {
+    return fromBack(packet.payload.getPtr(), packet.payload.size());
+  }
+
+  /// Reads the header from the back of the view.
+  bool fromView(const PacketView &view) {
+    return fromBack(view.getPtr(), view.size());
+  }
+
+protected:
+  /// Does nothing. Headers covering the payload replace it.
+  void seal(uint8_t *buffer, const PacketView *payload,
+            size_t numParts) const {}
+
+  /// Accepts every frame. Headers covering the payload replace it.
+  bool check(const uint8_t *frame, size_t size) const { return true; }
+
+private:
+  bool fromBack(const uint8_t *data, size_t size) {
+    if (size < HEADER::headerSize) {
       LOG_MSG("Not enough data to pop header! \n");
       return false;
     }
-    deserialize(packet.payload.getPtr() + packet.payload.size() -
-                getHeaderSize());
-    return true;
+    if (!self().check(data, size))
+      return false;
+    return static_cast<HEADER &>(*this).deserialize(data + size -
+                                                    HEADER::headerSize);
   }
+
+  const HEADER &self() const { return static_cast<const HEADER &>(*this); }
 };
 
 } // namespace VCTR::network
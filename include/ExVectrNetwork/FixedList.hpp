@@ -0,0 +1,61 @@
+#ifndef EXVECTRNETWORK_FIXEDLIST_HPP_
+#define EXVECTRNETWORK_FIXEDLIST_HPP_
+
+#include <stddef.h>
+
+namespace VCTR::network {
+
+/**
+ * @brief List with a fixed capacity in storage it does not own. Never
+ * allocates.
+ * @tparam T Type of the items.
+ */
+template <typename T> class FixedList {
+private:
+  T *items_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+
+public:
+  /**
+   * @param items Storage for the items. Must outlive the list.
+   * @param capacity Number of items the storage can hold.
+   */
+  FixedList(T *items, size_t capacity) : items_(items), capacity_(capacity) {}
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool isFull() const { return size_ >= capacity_; }
+
+  T *getPtr() { return items_; }
+  const T *getPtr() const { return items_; }
+
+  T &operator[](size_t index) { return items_[index]; }
+  const T &operator[](size_t index) const { return items_[index]; }
+
+  /**
+   * @brief Adds the item to the back of the list.
+   * @returns false if the list is full.
+   */
+  bool append(const T &item) {
+    if (isFull())
+      return false;
+    items_[size_++] = item;
+    return true;
+  }
+
+  /// Removes the item at the given index. Keeps the order of the others.
+  void removeAtIndex(size_t index) {
+    if (index >= size_)
+      return;
+    for (size_t i = index + 1; i < size_; i++)
+      items_[i - 1] = items_[i];
+    size_--;
+  }
+
+  void clear() { size_ = 0; }
+};
+
+} // namespace VCTR::network
+
+#endif
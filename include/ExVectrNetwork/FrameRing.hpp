@@ -0,0 +1,160 @@
+#ifndef EXVECTRNETWORK_FRAMERING_HPP_
+#define EXVECTRNETWORK_FRAMERING_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace VCTR::network {
+
+/**
+ * @brief Ring buffer of variable length frames in contiguous storage.
+ * @details Each frame is stored as a 2 byte length followed by its bytes, so a
+ * frame only takes the space it needs and the capacity is set in bytes.
+ * Frames may wrap around the end of the storage. A frame can be pushed at
+ * once or built up over multiple appends and then committed. Use
+ * FrameRingStatic to create a ring with its own storage.
+ * @note Not interrupt safe. Only use from scheduler tasks.
+ */
+class FrameRing {
+public:
+  /// Bytes used in front of each frame for its length.
+  static constexpr size_t recordHeaderSize = 2;
+
+private:
+  uint8_t *storage_ = nullptr;
+  size_t capacity_ = 0;
+
+  /// Index of the first byte of the oldest frame.
+  size_t head_ = 0;
+  /// Number of bytes used by committed frames.
+  size_t used_ = 0;
+  size_t numFrames_ = 0;
+
+  /// If a frame is being built behind the committed frames.
+  bool open_ = false;
+  /// Number of data bytes of the frame being built.
+  size_t openSize_ = 0;
+
+public:
+  /**
+   * @param storage Memory for the frames. Must outlive the ring.
+   * @param capacity Size of the storage in bytes.
+   */
+  FrameRing(uint8_t *storage, size_t capacity);
+
+  FrameRing(const FrameRing &) = delete;
+  FrameRing &operator=(const FrameRing &) = delete;
+
+  /**
+   * @brief Moves the ring to other storage. All frames are removed.
+   * @param storage Memory for the frames. Must outlive the ring.
+   * @param capacity Size of the storage in bytes.
+   */
+  void setStorage(uint8_t *storage, size_t capacity);
+
+  /**
+   * @brief Adds a frame to the back.
+   * @returns false if there is not enough space. Nothing is added then.
+   */
+  bool push(const uint8_t *data, size_t size);
+
+  /**
+   * @brief Starts a new frame at the back. Add its bytes with append() and
+   * finish it with commit(). An unfinished frame is discarded.
+   * @returns false if there is no space left.
+   */
+  bool begin();
+
+  /**
+   * @brief Adds bytes to the frame started with begin().
+   * @returns the number of bytes added. Less than size if out of space.
+   */
+  size_t append(const uint8_t *data, size_t size);
+
+  /// Makes the frame started with begin() available at the front.
+  void commit();
+
+  /// Discards the frame started with begin().
+  void abort();
+
+  /// Removes the last size bytes of the frame started with begin().
+  void shrink(size_t size) { openSize_ -= size < openSize_ ? size : openSize_; }
+
+  /// @returns if a frame was started with begin() and not yet committed.
+  bool isOpen() const { return open_; }
+
+  /// @returns the number of bytes of the frame started with begin().
+  size_t getOpenSize() const { return openSize_; }
+
+  /// @returns the size of the oldest frame. 0 if empty.
+  size_t frontSize() const;
+
+  /**
+   * @brief Copies the oldest frame into the given buffer.
+   * @param buffer Must fit frontSize() bytes.
+   * @returns the number of bytes copied.
+   */
+  size_t copyFront(uint8_t *buffer) const;
+
+  /**
+   * @brief Copies part of the oldest frame into the given buffer.
+   * @param offset Index of the first byte in the frame to copy.
+   * @param buffer Must fit size bytes.
+   * @param size Number of bytes to copy.
+   * @returns the number of bytes copied. Less than size at the frame end.
+   */
+  size_t readFront(size_t offset, uint8_t *buffer, size_t size) const;
+
+  /**
+   * @brief Gives part of the oldest frame without copying it. A frame that
+   * wraps around the end of the storage is given in two parts.
+   * @param offset Index of the first byte in the frame.
+   * @param size Set to the number of bytes that follow in the storage. 0 at
+   * the frame end.
+   * @returns a pointer to the byte at offset.
+   */
+  const uint8_t *peekFront(size_t offset, size_t &size) const;
+
+  /// Removes the oldest frame.
+  void pop();
+
+  /// Removes all frames.
+  void clear();
+
+  /// @returns the number of committed frames.
+  size_t numFrames() const { return numFrames_; }
+
+  /// @returns the number of bytes a new frame can still have.
+  size_t freeSpace() const;
+
+  size_t capacity() const { return capacity_; }
+
+private:
+  /// Copies bytes into the storage starting at the given index. Wraps around.
+  void write(size_t index, const uint8_t *data, size_t size);
+  /// Copies bytes from the storage starting at the given index. Wraps around.
+  void read(size_t index, uint8_t *data, size_t size) const;
+  /// @returns the index size bytes after the given index.
+  size_t advance(size_t index, size_t size) const;
+  /// @returns the number of unused bytes, ignoring the frame being built.
+  size_t unused() const;
+};
+
+/**
+ * @brief Frame ring with storage for the given number of bytes.
+ * @tparam CAPACITY Size of the storage in bytes. Each frame takes its size
+ * plus FrameRing::recordHeaderSize.
+ */
+template <size_t CAPACITY> class FrameRingStatic : public FrameRing {
+  static_assert(CAPACITY > recordHeaderSize, "Ring must fit a frame.");
+
+private:
+  uint8_t storage_[CAPACITY];
+
+public:
+  FrameRingStatic() : FrameRing(storage_, CAPACITY) {}
+};
+
+} // namespace VCTR::network
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef EXVECTRNETWORK_PACKETBUFFER_HPP_
+#define EXVECTRNETWORK_PACKETBUFFER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// Number of bytes a PacketBuffer stores without allocating. Default fits the
+/// SX1280 frame length (128) plus DataPacket::defaultTailroom. Set to 0 to
+/// always use pool or heap storage.
+#ifndef EXVECTRNETWORK_PACKET_INLINE_SIZE
+#define EXVECTRNETWORK_PACKET_INLINE_SIZE 144
+#endif
+
+/// Define EXVECTRNETWORK_STATIC_ALLOCATION to never use the heap. Storage then
+/// only comes from the inline storage and the pool and growing a buffer can
+/// fail. See README.
+
+namespace VCTR::network {
+
+class PacketPool;
+class PacketView;
+
+/**
+ * @brief Byte buffer used as the payload of a DataPacket.
+ * @details Every layer appends its header to the back of the payload. The
+ * buffer therefore keeps spare capacity behind the data (tailroom), so that
+ * adding a header is only a size increment as long as enough tailroom was
+ * reserved when the packet was created.
+ * Up to inlineCapacity bytes are stored inside the buffer itself, so small
+ * packets never allocate and copying them is a single memcpy. Larger buffers
+ * take storage from the pool if one is set, the size fits into a slot and the
+ * pool is not exhausted. Otherwise the heap is used, unless
+ * EXVECTRNETWORK_STATIC_ALLOCATION is defined. Then growing fails instead.
+ * Storage outside of the buffer is reference counted. Copies share it and the
+ * storage is freed when the last copy is destroyed. Modifying a shared buffer
+ * (non-const access, push, append, growing) first makes a private copy, so
+ * read shared buffers through const references.
+ */
+class PacketBuffer {
+public:
+  /// Number of bytes stored inside the buffer without allocating.
+  static constexpr size_t inlineCapacity = EXVECTRNETWORK_PACKET_INLINE_SIZE;
+
+private:
+  uint8_t inline_[inlineCapacity > 0 ? inlineCapacity : 1];
+
+  /// Start of the storage outside of the buffer. Begins with the reference
+  /// count followed by the data. nullptr if the data is inline.
+  uint8_t *storage_ = nullptr;
+
+  uint8_t *data_ = inline_;
+  size_t size_ = 0;
+  size_t capacity_ = inlineCapacity;
+
+  /// Pool to take storage from. Heap only if nullptr.
+  PacketPool *pool_ = nullptr;
+  /// Pool the current storage was taken from. nullptr if from the heap.
+  PacketPool *storagePool_ = nullptr;
+
+public:
+  PacketBuffer() = default;
+
+  /**
+   * @brief Creates a buffer with the given size and additional tailroom.
+   * @param size Number of bytes the buffer contains. Content is undefined.
+   * @param tailroom Number of bytes to reserve behind the data.
+   */
+  explicit PacketBuffer(size_t size, size_t tailroom = 0);
+
+  /**
+   * @brief Creates a buffer containing a copy of the given data.
+   * @param data Pointer to the data to copy.
+   * @param size Number of bytes to copy.
+   * @param tailroom Number of bytes to reserve behind the data.
+   */
+  PacketBuffer(const uint8_t *data, size_t size, size_t tailroom = 0);
+
+  /// Bytes at the start of outside storage used for the reference count.
+  static constexpr size_t storageHeaderSize = sizeof(uint16_t);
+
+  /// Shares storage with the original if it is outside of the buffer,
+  /// otherwise copies the data. The copy keeps at least the same tailroom and
+  /// the same pool as the original.
+  PacketBuffer(const PacketBuffer &other);
+  PacketBuffer &operator=(const PacketBuffer &other);
+
+  /// Takes the storage of the other buffer. Only inline data is copied.
+  PacketBuffer(PacketBuffer &&other);
+  PacketBuffer &operator=(PacketBuffer &&other);
+
+  /**
+   * @brief Creates a buffer containing the data of the view. Shares the
+   * storage of the buffer the view points into if the view starts at its
+   * front and the storage is outside of the buffer. Otherwise copies.
+   */
+  explicit PacketBuffer(const PacketView &view);
+
+  ~PacketBuffer();
+
+  /// @returns the number of bytes in the buffer.
+  size_t size() const { return size_; }
+
+  /// @returns the number of bytes the buffer can hold without reallocating.
+  size_t capacity() const { return capacity_; }
+
+  /// @returns the number of bytes that can be pushed without reallocating.
+  size_t tailroom() const { return capacity_ - size_; }
+
+  /// @note Makes a private copy first if the storage is shared.
+  uint8_t *getPtr() {
+    makeUnique();
+    return data_;
+  }
+  const uint8_t *getPtr() const { return data_; }
+
+  /// @note Makes a private copy first if the storage is shared.
+  uint8_t &operator[](size_t index) {
+    makeUnique();
+    return data_[index];
+  }
+  const uint8_t &operator[](size_t index) const { return data_[index]; }
+
+  /**
+   * @brief Makes sure the buffer can hold at least the given number of bytes.
+   * @note Reallocates and copies the data if the capacity is too small.
+   * @returns false if no storage could be allocated. The buffer is unchanged.
+   */
+  bool reserve(size_t capacity);
+
+  /**
+   * @brief Makes sure at least the given number of bytes can be pushed to the
+   * back without reallocating.
+   * @returns false if no storage could be allocated.
+   */
+  bool reserveTailroom(size_t bytes);
+
+  /**
+   * @brief Changes the number of bytes in the buffer. New bytes are undefined.
+   * @returns false if no storage could be allocated. The size is unchanged.
+   */
+  bool setSize(size_t size);
+
+  /**
+   * @brief Grows the buffer by the given number of bytes.
+   * @note Only a size increment if there is enough tailroom.
+   * @returns pointer to the first of the new bytes or nullptr if no storage
+   * could be allocated.
+   */
+  uint8_t *push(size_t bytes);
+
+  /// Removes the given number of bytes from the back of the buffer.
+  void popDiscard(size_t bytes);
+
+  /// Appends a single byte to the back of the buffer.
+  bool append(uint8_t byte);
+
+  /// Appends a copy of the given data to the back of the buffer.
+  bool append(const uint8_t *data, size_t size);
+
+  /// Removes all bytes. The capacity is kept for reuse.
+  void clear() { size_ = 0; }
+
+  /// Removes all bytes and releases the storage.
+  void reset();
+
+  /**
+   * @brief Sets the pool used for future storage allocations.
+   * @param pool The pool to use or nullptr to only use the heap.
+   */
+  void setPool(PacketPool *pool) { pool_ = pool; }
+
+  PacketPool *getPool() const { return pool_; }
+
+  /// Exchanges content and pool with the other buffer. Only inline content is
+  /// copied.
+  void swap(PacketBuffer &other);
+
+  /// @returns true if the data is stored inside the buffer.
+  bool isInline() const { return storage_ == nullptr; }
+
+  /// @returns the number of buffers using this storage. 1 if inline.
+  uint16_t getRefCount() const {
+    uint16_t count = 1;
+    if (storage_ != nullptr)
+      memcpy(&count, storage_, sizeof(count));
+    return count;
+  }
+
+  /// @returns true if other buffers use the same storage.
+  bool isShared() const { return getRefCount() > 1; }
+
+  /// Makes a private copy of the storage if it is shared.
+  /// @note Stays shared if no storage could be allocated.
+  void makeUnique() {
+    if (isShared())
+      reallocate(capacity_, true);
+  }
+
+  /**
+   * @brief Moves inline data to storage outside of the buffer, so that copies
+   * share it instead of copying. Call before handing a packet to multiple
+   * receivers that each keep it. Not needed for received frames, as keeping
+   * an inline frame copies no more than its used bytes.
+   */
+  void makeShareable();
+
+private:
+  void setRefCount(uint16_t count) { memcpy(storage_, &count, sizeof(count)); }
+
+  /**
+   * @brief Moves the data into new storage of the given capacity.
+   * @param capacity Minimum capacity of the new storage.
+   * @param allowInline If the inline storage may be used.
+   * @returns false if no storage could be allocated. The buffer is unchanged.
+   */
+  bool reallocate(size_t capacity, bool allowInline);
+
+  /// Drops this buffers reference to the storage, freeing it if it was the
+  /// last, and switches back to the inline storage.
+  void freeStorage();
+
+  /// Takes the content of the other buffer, leaving it empty. Storage outside
+  /// of the buffer is handed over without copying.
+  void takeContent(PacketBuffer &other);
+};
+
+} // namespace VCTR::network
+
+#endif
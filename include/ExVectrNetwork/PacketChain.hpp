@@ -0,0 +1,97 @@
+#ifndef EXVECTRNETWORK_PACKETCHAIN_HPP_
+#define EXVECTRNETWORK_PACKETCHAIN_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ExVectrNetwork/PacketView.hpp"
+#include "ExVectrNetwork/Priority.hpp"
+
+namespace VCTR::network {
+
+/**
+ * @brief Packet made of multiple fragments that are only gathered into one
+ * buffer when written to the physical device (scatter-gather).
+ * @details Payload fragments point to data owned by the sender and are not
+ * copied. Headers and trailers are pushed into a small buffer inside the
+ * chain. Each layer pushes its header to the back, same as with DataPacket, so
+ * the gathered bytes are identical.
+ * @note Payload fragments are only valid during the send call. Datalinks that
+ * queue the packet must gather it into a DataPacket.
+ */
+class PacketChain {
+public:
+  /// Maximum number of fragments in a chain.
+  static constexpr size_t maxFragments = 6;
+  /// Bytes available for headers and trailers pushed into the chain.
+  static constexpr size_t localCapacity = 32;
+
+private:
+  struct Fragment {
+    /// Data owned by the sender. nullptr if the data is in local_.
+    const uint8_t *data;
+    /// Index into local_ if data is nullptr.
+    uint8_t offset;
+    uint16_t size;
+  };
+
+  Fragment fragments_[maxFragments];
+  size_t numFragments_ = 0;
+
+  uint8_t local_[localCapacity];
+  size_t localSize_ = 0;
+
+  size_t size_ = 0;
+
+public:
+  /// The time when this packet should be sent. 0 for as soon as possible.
+  int64_t timestamp = 0;
+
+  /// Queue the datalinks transmit this packet from.
+  Priority priority = Priority::NORMAL;
+
+  PacketChain() = default;
+
+  /**
+   * @brief Adds a fragment pointing to the given data. Nothing is copied.
+   * @returns false if the chain has no free fragment or size is too large.
+   */
+  bool append(const uint8_t *data, size_t size);
+
+  /// Adds a fragment pointing to the data of the view.
+  bool append(const PacketView &view) {
+    return append(view.getPtr(), view.size());
+  }
+
+  /**
+   * @brief Adds bytes to the back of the chain, stored inside the chain. Used
+   * for headers and trailers.
+   * @returns pointer to the new bytes or nullptr if there is no space left.
+   */
+  uint8_t *push(size_t size);
+
+  /// @returns the total number of bytes in the chain.
+  size_t size() const { return size_; }
+
+  size_t getNumFragments() const { return numFragments_; }
+
+  /// @returns a view of the fragment at the given index.
+  PacketView getFragment(size_t index) const;
+
+  /**
+   * @brief Gathers bytes of the chain into a contiguous buffer.
+   * @param buffer Where to copy the bytes to.
+   * @param offset Index of the first byte in the chain to copy.
+   * @param size Maximum number of bytes to copy.
+   * @returns the number of bytes copied.
+   */
+  size_t copyTo(uint8_t *buffer, size_t offset = 0,
+                size_t size = SIZE_MAX) const;
+
+  /// Removes all fragments.
+  void clear();
+};
+
+} // namespace VCTR::network
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef EXVECTRNETWORK_PACKETLAYOUT_HPP_
+#define EXVECTRNETWORK_PACKETLAYOUT_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+#include <utility>
+
+namespace VCTR::network::layout {
+
+/**
+ * @brief A big endian field at a fixed position in a header.
+ * @details Everything is known at compile time, so reading and writing a field
+ * folds into a few loads and stores. Chain fields with the end of the previous
+ * one to describe a header:
+ * @code
+ * using Type = Field<uint8_t, 0>;
+ * using Address = Field<uint16_t, Type::end>;
+ * static constexpr size_t size = Address::end;
+ * @endcode
+ * @tparam T Type of the field. Integer or enum.
+ * @tparam OFFSET Index of the first byte of the field.
+ */
+template <typename T, size_t OFFSET> struct Field {
+private:
+  using Raw = typename std::conditional_t<std::is_enum_v<T>,
+                                          std::underlying_type<T>,
+                                          std::common_type<T>>::type;
+  static_assert(std::is_integral_v<Raw>, "Fields must be integers or enums.");
+
+  template <size_t... I>
+  static inline void writeBytes(uint8_t *buffer, Raw value,
+                                std::index_sequence<I...>) {
+    ((buffer[OFFSET + I] = uint8_t(value >> (8 * (size - 1 - I)))), ...);
+  }
+
+  template <size_t... I>
+  static inline Raw readBytes(const uint8_t *buffer,
+                              std::index_sequence<I...>) {
+    return Raw(((Raw(buffer[OFFSET + I]) << (8 * (size - 1 - I))) | ...));
+  }
+
+public:
+  static constexpr size_t offset = OFFSET;
+  static constexpr size_t size = sizeof(T);
+  /// Index of the first byte after this field.
+  static constexpr size_t end = OFFSET + size;
+
+  static inline void write(uint8_t *buffer, T value) {
+    writeBytes(buffer, Raw(value), std::make_index_sequence<size>());
+  }
+
+  static inline T read(const uint8_t *buffer) {
+    return T(readBytes(buffer, std::make_index_sequence<size>()));
+  }
+};
+
+namespace detail {
+template <size_t BEGIN, size_t... I>
+inline uint8_t byteSum(const uint8_t *buffer, std::index_sequence<I...>) {
+  return uint8_t((0 + ... + buffer[BEGIN + I]));
+}
+} // namespace detail
+
+/**
+ * @returns the 8 bit sum of the bytes from BEGIN up to END. Unrolled at
+ * compile time.
+ */
+template <size_t BEGIN, size_t END>
+inline uint8_t byteSum(const uint8_t *buffer) {
+  static_assert(BEGIN <= END, "Range is reversed.");
+  return detail::byteSum<BEGIN>(buffer,
+                                std::make_index_sequence<END - BEGIN>());
+}
+
+} // namespace VCTR::network::layout
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef EXVECTRNETWORK_PACKETMETADATA_HPP_
+#define EXVECTRNETWORK_PACKETMETADATA_HPP_
+
+#include <stdint.h>
+
+namespace VCTR::network {
+
+/**
+ * @brief Receive information of a single packet, filled in by the datalink
+ * that received it.
+ * @note Datalinks without this information leave valid false.
+ */
+struct PacketMetadata {
+  /// Time the receive done interrupt was triggered. 0 if unknown.
+  int64_t irqTimestamp = 0;
+  /// Frequency error of the packet in Hz.
+  int32_t frequencyError = 0;
+  /// Signal strength of the packet in dBm.
+  int16_t rssi = 0;
+  /// Signal to noise ratio of the packet in dB.
+  int8_t snr = 0;
+  /// Index of the channel the packet was received on.
+  uint8_t channel = 0;
+  /// True if the datalink filled in the values above.
+  bool valid = false;
+};
+
+} // namespace VCTR::network
+
+#endif
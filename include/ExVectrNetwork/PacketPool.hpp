@@ -0,0 +1,111 @@
+#ifndef EXVECTRNETWORK_PACKETPOOL_HPP_
+#define EXVECTRNETWORK_PACKETPOOL_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Slot size of the default pool. Default fits the largest generic datalink
+/// frame.
+#ifndef EXVECTRNETWORK_PACKET_POOL_SLOT_SIZE
+#define EXVECTRNETWORK_PACKET_POOL_SLOT_SIZE 256
+#endif
+
+/// Number of slots of the default pool.
+#ifndef EXVECTRNETWORK_PACKET_POOL_NUM_SLOTS
+#define EXVECTRNETWORK_PACKET_POOL_NUM_SLOTS 8
+#endif
+
+namespace VCTR::network {
+
+/**
+ * @brief Pool of fixed-size slots used as packet payload storage.
+ * @details Taking and returning a slot is O(1) and never touches the heap. The
+ * free slots are kept in a list stored inside the slots themselves. Use
+ * PacketPoolStatic to create a pool with its own storage.
+ * @note Not interrupt safe. Only use from scheduler tasks.
+ */
+class PacketPool {
+private:
+  uint8_t *storage_ = nullptr;
+  size_t slotSize_ = 0;
+  size_t numSlots_ = 0;
+
+  /// First free slot. The first bytes of each free slot point to the next.
+  uint8_t *freeList_ = nullptr;
+  size_t numFree_ = 0;
+  size_t minFree_ = 0;
+  uint32_t exhaustedCount_ = 0;
+
+public:
+  /**
+   * @param storage Memory for the slots. Must be at least slotSize * numSlots
+   * bytes and outlive the pool.
+   * @param slotSize Size of each slot in bytes. Minimum is sizeof(void *).
+   * @param numSlots Number of slots.
+   */
+  PacketPool(uint8_t *storage, size_t slotSize, size_t numSlots);
+
+  PacketPool(const PacketPool &) = delete;
+  PacketPool &operator=(const PacketPool &) = delete;
+
+  /**
+   * @brief Takes a free slot from the pool.
+   * @param size The number of bytes needed.
+   * @returns pointer to the slot or nullptr if size is larger than a slot or
+   * the pool is exhausted.
+   */
+  uint8_t *acquire(size_t size);
+
+  /**
+   * @brief Returns a slot taken with acquire() to the pool.
+   */
+  void release(uint8_t *slot);
+
+  /// @returns true if the given pointer is a slot of this pool.
+  bool owns(const uint8_t *ptr) const;
+
+  size_t getSlotSize() const { return slotSize_; }
+  size_t getNumSlots() const { return numSlots_; }
+  size_t getNumFree() const { return numFree_; }
+
+  /// @returns the lowest number of free slots seen. Useful to size the pool.
+  size_t getMinFree() const { return minFree_; }
+
+  /// @returns how often a slot was requested while none were free.
+  uint32_t getExhaustedCount() const { return exhaustedCount_; }
+};
+
+/**
+ * @brief Packet pool with storage for the given number of slots.
+ * @tparam SLOTSIZE Size of each slot in bytes.
+ * @tparam NUMSLOTS Number of slots.
+ */
+template <size_t SLOTSIZE, size_t NUMSLOTS>
+class PacketPoolStatic : public PacketPool {
+  static_assert(SLOTSIZE >= sizeof(void *), "Slots must fit a pointer.");
+
+private:
+  uint8_t slots_[SLOTSIZE * NUMSLOTS];
+
+public:
+  PacketPoolStatic() : PacketPool(slots_, SLOTSIZE, NUMSLOTS) {}
+
+  /// @returns the number of bytes used by this pool including the slots.
+  static constexpr size_t getMemorySize() { return sizeof(PacketPoolStatic); }
+};
+
+/// Slot size of the default pool.
+static constexpr size_t defaultPacketPoolSlotSize =
+    EXVECTRNETWORK_PACKET_POOL_SLOT_SIZE;
+/// Number of slots of the default pool.
+static constexpr size_t defaultPacketPoolNumSlots =
+    EXVECTRNETWORK_PACKET_POOL_NUM_SLOTS;
+
+/**
+ * @returns the pool datalinks allocate received packets from by default.
+ */
+PacketPool &getDefaultPacketPool();
+
+} // namespace VCTR::network
+
+#endif
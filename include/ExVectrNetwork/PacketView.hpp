@@ -0,0 +1,74 @@
+#ifndef EXVECTRNETWORK_PACKETVIEW_HPP_
+#define EXVECTRNETWORK_PACKETVIEW_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ExVectrNetwork/PacketMetadata.hpp"
+
+namespace VCTR::network {
+
+class PacketBuffer;
+
+/**
+ * @brief Non-owning view into packet data.
+ * @details Used to pass a payload up the layers without copying it. The data
+ * is only valid for the duration of the handler call the view is passed to.
+ * To keep it afterwards create a PacketBuffer from the view. This shares the
+ * storage of the buffer the view points into instead of copying if possible.
+ */
+class PacketView {
+private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  /// The buffer the data is in. nullptr if unknown.
+  const PacketBuffer *buffer_ = nullptr;
+
+public:
+  /// The time when the packet this view points into was received.
+  int64_t timestamp = 0;
+
+  /// Receive information of the packet this view points into.
+  PacketMetadata metadata;
+
+  PacketView() = default;
+
+  /**
+   * @param data Pointer to the first byte.
+   * @param size Number of bytes.
+   * @param timestamp The time the packet was received.
+   * @param buffer The buffer the data is in. Allows taking the data without
+   * copying.
+   */
+  PacketView(const uint8_t *data, size_t size, int64_t timestamp = 0,
+             const PacketBuffer *buffer = nullptr)
+      : data_(data), size_(size), buffer_(buffer), timestamp(timestamp) {}
+
+  const uint8_t *getPtr() const { return data_; }
+
+  /// @returns the buffer the data is in or nullptr if unknown.
+  const PacketBuffer *getBuffer() const { return buffer_; }
+
+  size_t size() const { return size_; }
+
+  const uint8_t &operator[](size_t index) const { return data_[index]; }
+
+  /**
+   * @returns a view of a part of this view. Is clamped to this view.
+   * @param offset Index of the first byte.
+   * @param size Number of bytes.
+   */
+  PacketView subView(size_t offset, size_t size) const {
+    if (offset > size_)
+      offset = size_;
+    if (size > size_ - offset)
+      size = size_ - offset;
+    PacketView view(data_ + offset, size, timestamp, buffer_);
+    view.metadata = metadata;
+    return view;
+  }
+};
+
+} // namespace VCTR::network
+
+#endif
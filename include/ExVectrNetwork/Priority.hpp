@@ -0,0 +1,27 @@
+#ifndef EXVECTRNETWORK_PRIORITY_HPP_
+#define EXVECTRNETWORK_PRIORITY_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace VCTR::network {
+
+/**
+ * @brief Transmit priority class of a packet. Datalinks queue each class
+ * separately, so control messages do not wait behind bulk transfers.
+ */
+enum class Priority : uint8_t {
+  /// Small, urgent messages like heartbeats and commands.
+  CONTROL = 0,
+  /// Default for all packets.
+  NORMAL = 1,
+  /// Large transfers that may wait, like log dumps.
+  BULK = 2
+};
+
+/// Number of priority classes.
+static constexpr size_t numPriorities = 3;
+
+} // namespace VCTR::network
+
+#endif
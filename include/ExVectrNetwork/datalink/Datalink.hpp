@@ -2,35 +2,93 @@
 #define EXVECTRNETWORK_DATALINK_H_
 
 #include "ExVectrCore/list.hpp"
-#include "ExVectrCore/list_buffer.hpp"
 #include "ExVectrCore/task_types.hpp"
 #include "ExVectrCore/topic.hpp"
 #include "ExVectrCore/topic_subscribers.hpp"
 
 #include "ExVectrHAL/digital_io.hpp"
 
+#include "ExVectrNetwork/Cobs.hpp"
+#include "ExVectrNetwork/FrameRing.hpp"
 #include "ExVectrNetwork/datalink/DatalinkI.hpp"
+#include "ExVectrNetwork/datalink/TransmitQueue.hpp"
+#include "ExVectrNetwork/physical/ReadyNotifier.hpp"
 
 namespace VCTR::network::datalink {
 
 /**
  * @brief   Datalink layer class is a general implementation for use with any
- * physical layer implementing the HAL::DigitalIO interface.
- *
+ * physical layer implementing the HAL::DigitalIO interface. Frames are buffered
+ * in storage given by the derived class. Use Datalink or DatalinkJumbo.
+ * @note    The physical layer is polled for new data. Physical layers that can
+ * notify (ReadyNotifier or an RX interrupt calling notifyReady()) wake the
+ * datalink immediately instead.
  */
-class Datalink : public DatalinkI, public Core::Task_Periodic {
+class DatalinkBase : public DatalinkI,
+                     public Core::Task_Periodic,
+                     public physical::ReadyListener {
 public:
-  ///@brief Maximum length a data frame can be.
+  ///@brief Default maximum length a data frame can be. See setMaxFrameLength()
+  /// for larger frames.
   static constexpr size_t dataLinkMaxFrameLength = 230;
-  ///@brief Maximum number of frames that can be stored in the buffer.
-  static constexpr size_t dataLinkBufferFrameLength = 5;
+  ///@brief Size of the receive buffer in bytes. Frames only take the space
+  /// they need, so many small frames fit where few large ones do.
+  static constexpr size_t dataLinkBufferSize =
+      5 * (dataLinkMaxFrameLength + FrameRing::recordHeaderSize);
+  ///@brief Default number of bytes read and written in a single run. Enough
+  /// for a full transmit and receive buffer.
+  static constexpr size_t defaultByteBudget = 2 * dataLinkBufferSize;
+  ///@brief Maximum number of frame bytes sent with a single data command.
+  static constexpr size_t maxDataChunk = 250;
+  ///@brief Maximum number of frame bytes sent with a single long data command.
+  static constexpr size_t maxLongDataChunk = UINT16_MAX;
+  ///@brief Size of the CRC-16 sent behind each frame if enabled.
+  static constexpr size_t crcTrailerSize = 2;
+  ///@brief Size of the transmit buffer in bytes. Holds as many frames of the
+  /// NORMAL priority as the receive buffer and half as many of the others.
+  static constexpr size_t transmitBufferSize =
+      2 * 5 *
+      (dataLinkMaxFrameLength + crcTrailerSize + TransmitQueue::recordOverhead);
+  ///@brief Largest frame length that can be set. A frame and its CRC-16 must
+  /// fit into a FrameRing record, also with the timestamp of the queue.
+  static constexpr size_t maxJumboFrameLength =
+      TransmitQueue::maxFrameSize - crcTrailerSize;
+  ///@brief How often a frame interrupted by another node is sent again when
+  /// using CSMA.
+  static constexpr size_t csmaMaxRetries = 8;
 
-private:
-  enum class PhysicalHeader { BLOCK = 0, FREE = 1, DATA = 2 };
+  /// Counts of medium access events.
+  struct AccessCounters {
+    /// Own windows interrupted by another node.
+    uint32_t collisions = 0;
+    /// Backoffs given up because another node started first.
+    uint32_t deferrals = 0;
+    /// Interrupted frames sent again.
+    uint32_t retries = 0;
+    /// Interrupted frames dropped.
+    uint32_t dropped = 0;
+  };
+
+  /// How commands are framed on the physical layer.
+  enum class Framing {
+    /// Command byte, followed by a length byte and data for data commands.
+    /// Smallest, but a lost or extra byte breaks parsing until the medium is
+    /// released.
+    HEADERS,
+    /// Each command and its data is COBS encoded and ends with a zero byte.
+    /// The receiver resynchronises at the next zero byte after an error.
+    COBS
+  };
 
-  struct PhysicalFrame {
-    uint8_t data[dataLinkMaxFrameLength];
-    uint8_t length;
+private:
+  /// DATA_LONG is DATA with a 16 bit length. Used for frames longer than
+  /// dataLinkMaxFrameLength.
+  enum class PhysicalHeader {
+    BLOCK = 0,
+    FREE = 1,
+    DATA = 2,
+    END = 3,
+    DATA_LONG = 4
   };
 
   ///@brief If the physicallayer is currently blocked. Cannot send during this
@@ -43,37 +101,132 @@ private:
   /// last received data.
   int64_t physicalReleaseTime_ = 100 * Core::MILLISECONDS;
 
+  ///@brief If physicalReleaseTime_ is derived from the observed gaps.
+  bool adaptiveRelease_ = false;
+  ///@brief Bounds of the adaptive release time.
+  int64_t minReleaseTime_ = 0;
+  int64_t maxReleaseTime_ = 0;
+  ///@brief Number of gap deviations added to the mean gap.
+  uint16_t releaseDeviationFactor_ = 4;
+  ///@brief Smoothed largest gap between received commands in a window.
+  int64_t gapMean_ = 0;
+  ///@brief Smoothed mean deviation of gapMean_.
+  int64_t gapDeviation_ = 0;
+  ///@brief If gapMean_ has been set from a window.
+  bool gapSampled_ = false;
+  ///@brief If the gaps of the current window are measured. Only for windows
+  /// whose block was received.
+  bool measuringWindow_ = false;
+  ///@brief Largest gap between received commands in the current window.
+  int64_t windowMaxGap_ = 0;
+  ///@brief When the last command or data was received.
+  int64_t lastReceiveTime_ = 0;
+
+  ///@brief Maximum number of bytes read and written in a single run.
+  size_t byteBudget_ = defaultByteBudget;
+  ///@brief Larger frames are not sent and dropped when received.
+  size_t maxFrameLength_ = dataLinkMaxFrameLength;
+
+  ///@brief Duration of a backoff slot. 0 if CSMA is disabled.
+  int64_t slotTime_ = 0;
+  ///@brief Number of slots to choose from after a successful window.
+  uint16_t minWindow_ = 0;
+  ///@brief Largest number of slots to choose from.
+  uint16_t maxWindow_ = 0;
+  ///@brief Current number of slots to choose from. Doubles on collisions.
+  uint16_t contentionWindow_ = 0;
+  ///@brief If waiting for a backoff to end before blocking the medium.
+  bool backingOff_ = false;
+  ///@brief When the current backoff ends.
+  int64_t backoffEnd_ = 0;
+  ///@brief State of the random number generator for backoffs.
+  uint32_t randomState_ = 1;
+  ///@brief If our window was interrupted by another node. Both stopped, so the
+  /// medium is released after a silence of two slots.
+  bool collided_ = false;
+  ///@brief How often the frame in front of transmitBuffer_ was sent again.
+  size_t resends_ = 0;
+  AccessCounters accessCounters_;
+
+  ///@brief How commands are framed on the physical layer.
+  Framing framing_ = Framing::HEADERS;
+  ///@brief Encoded bytes of the COBS record being received.
+  uint8_t cobsBuffer_[cobs::maxEncodedSize(1 + maxDataChunk)];
+  ///@brief Number of bytes in cobsBuffer_.
+  size_t cobsSize_ = 0;
+  ///@brief If the record being received is too large and will be dropped.
+  bool cobsOverflow_ = false;
+
+  ///@brief If a CRC-16 is sent behind and checked at the end of each frame.
+  bool frameCrc_ = false;
+  ///@brief CRC-16 of the frame being received so far.
+  uint16_t receiveCrc_ = 0;
+  ReceiveCounters receiveCounters_;
+
   ///@brief if we are currently transmitting data.
   bool transmitting_ = false;
   ///@brief The number of bytes to transmit.
   size_t numBytesTransmit_ = 0;
+  ///@brief Maximum number of frame bytes sent in one block/free window. 0 to
+  /// send a single frame per window.
+  size_t aggregateMaxBytes_ = 0;
+  ///@brief Maximum time to hold the medium for more frames.
+  int64_t aggregateMaxTime_ = 0;
+  ///@brief When the medium was blocked for the current window.
+  int64_t windowStart_ = 0;
+  ///@brief Number of frame bytes sent in the current window.
+  size_t windowBytes_ = 0;
+  ///@brief Index of the next byte to send of the frame in front of
+  /// transmitBuffer_. The frame is removed once sent.
+  size_t transmitOffset_ = 0;
 
   ///@brief If we are currently receiving data.
   bool receiving_ = false;
   ///@brief number of bytes to still be received.
   size_t numBytesReceive_ = 0;
+  ///@brief Command and length bytes of the data command being read. Data
+  /// commands are only handled once their length is complete.
+  uint8_t receiveHeader_[3];
+  ///@brief Number of bytes in receiveHeader_.
+  size_t receiveHeaderSize_ = 0;
 
   ///@brief The physical layer that offers IO interface for reading/writing.
   HAL::DigitalIO *physicalLayer_ = nullptr;
 
-  ///@brief Buffer for data to transmit.
-  Core::ListBuffer<PhysicalFrame, 5> transmitBuffer_;
-  ///@brief Buffer for data to transmit.
-  Core::ListBuffer<PhysicalFrame, 5> receiveBuffer_;
+  ///@brief Set by notifyReady(), possibly from an interrupt. Cleared when the
+  /// datalink runs.
+  volatile bool wakeupPending_ = false;
+  ///@brief If the physical layer must be polled for new data. False if it
+  /// notifies.
+  bool pollPhysical_ = true;
+
+  ///@brief Buffer for frames to transmit, queued by priority.
+  TransmitQueue transmitBuffer_;
+  ///@brief Buffer for received frames. The frame being received is open until
+  /// the medium is freed.
+  FrameRing receiveBuffer_;
+  ///@brief If the frame being received was dropped. The rest of it is
+  /// ignored until it ends with an end, free or block command.
+  bool receiveDiscard_ = false;
 
   // Debugging byte counter
   // size_t counter_ = 0;
 
-public:
+protected:
   /**
-   * @brief Constructor. This requires an IO interface of an object, usually a
-   * physical layer but can be a topic offering this interface.
-   * @note The physical layer is simply a medium to transfer raw data, this can
-   * be a LoRa device like SX1280 or UART, SPI etc.
    * @param physicalLayerDevice The object used as the physical layer.
+   * @param transmitStorage Storage for frames queued for transmission. Must
+   * outlive the datalink.
+   * @param transmitSize Size of transmitStorage in bytes.
+   * @param receiveStorage Storage for received frames. Must outlive the
+   * datalink.
+   * @param receiveSize Size of receiveStorage in bytes.
    */
-  Datalink(HAL::DigitalIO &physicalLayerDevice,
-           Core::Scheduler &scheduler = Core::getSystemScheduler());
+  DatalinkBase(HAL::DigitalIO &physicalLayerDevice, uint8_t *transmitStorage,
+               size_t transmitSize, uint8_t *receiveStorage,
+               size_t receiveSize, Core::Scheduler &scheduler);
+
+public:
 
   /**
    * @brief Removes the given transmit topic from subscription.
@@ -89,12 +242,123 @@ public:
    * take multiple seconds -> timeout of 5 seconds. Warning, something going
    * wrong on the channel can cause datatransfer to be blocked for the amount of
    * time.
+   * @note Disables the adaptive timeout.
    * @param time
    */
   void setPhysicalReleaseTimeout(int64_t time);
 
+  /**
+   * @brief Derives the release timeout from the traffic instead of a fixed
+   * value. The largest gap between received commands of each window is
+   * smoothed, and the timeout is its mean plus deviationFactor times its mean
+   * deviation, but at least 1.5 times the mean. A lost free command then costs
+   * little more than the usual gaps on the link.
+   * @param minTime Lower bound of the timeout.
+   * @param maxTime Upper bound of the timeout. Used until the first window
+   * was measured.
+   * @param deviationFactor Larger values release later but less often too
+   * early.
+   */
+  void setAdaptiveReleaseTimeout(int64_t minTime, int64_t maxTime,
+                                 uint16_t deviationFactor = 4);
+
+  /// @returns the current release timeout.
+  int64_t getPhysicalReleaseTimeout() const;
+
+  /**
+   * @brief Sets the largest frame this link sends and receives. Frames longer
+   * than dataLinkMaxFrameLength are sent with 16 bit data lengths when using
+   * header framing, so both ends must use the same setting. A frame being
+   * received is dropped.
+   * @note Use DatalinkJumbo to get a datalink with storage for large frames.
+   * @param length Maximum frame length. At most maxJumboFrameLength.
+   */
+  void setMaxFrameLength(size_t length);
+
+  /**
+   * @brief Sets how commands are framed on the physical layer. Both ends must
+   * use the same framing.
+   * @param framing Framing::COBS for noisy links like long RS-485 runs.
+   */
+  void setFraming(Framing framing);
+
+  /**
+   * @brief Sends a CRC-16 behind each frame and drops received frames with a
+   * wrong CRC before they are handed on. Both ends must use the same setting.
+   * @note Frames already queued are sent as they were queued.
+   */
+  void setFrameCrc(bool enable);
+
+  /// @returns the counts of received and dropped frames.
+  const ReceiveCounters &getReceiveCounters() const;
+
+  void resetReceiveCounters();
+
+  /**
+   * @brief Sends all queued frames in one block/free window instead of
+   * acquiring the medium for each frame. Each frame is closed with an end
+   * command. Receivers must support it, so this is off by default.
+   * @param maxBytes Maximum number of frame bytes per window. 0 disables
+   * aggregation.
+   * @param maxTime Maximum time to hold the medium for more frames.
+   */
+  void setAggregation(size_t maxBytes,
+                      int64_t maxTime = 50 * Core::MILLISECONDS);
+
+  /**
+   * @brief Enables carrier sense with random exponential backoff. Before
+   * blocking a free medium the datalink waits a random number of slots and
+   * gives up its turn if another node starts first. If another node talks
+   * during the own window, the window doubles and the interrupted frame is sent
+   * again. The window goes back to minWindow after a successful transfer.
+   * @param slotTime Duration of a slot. Should be longer than it takes a block
+   * command to reach all nodes. 0 disables CSMA.
+   * @param minWindow Number of slots to choose from after a success.
+   * @param maxWindow Largest number of slots to choose from.
+   */
+  void setCsma(int64_t slotTime, uint16_t minWindow = 4,
+               uint16_t maxWindow = 256);
+
+  /**
+   * @brief Seeds the backoff random numbers. Give each node a different seed,
+   * like its address, so nodes that start together pick different slots.
+   */
+  void setRandomSeed(uint32_t seed);
+
+  /// @returns the counts of medium access events.
+  const AccessCounters &getAccessCounters() const;
+
+  void resetAccessCounters();
+
+  void setTransmitScheduling(TransmitScheduling scheduling) override;
+
+  void setPriorityWeight(Priority priority, uint16_t weight) override;
+
+  /**
+   * @brief Sets how many bytes a single run may read and write. The datalink
+   * keeps receiving and transmitting until nothing is left or this is used up.
+   * Lower it to bound the time a run takes on slow physical layers.
+   * @param bytes Maximum number of bytes per run. At least 3.
+   */
+  void setByteBudget(size_t bytes);
+
+  /**
+   * @brief Wakes the datalink on the next scheduler pass to handle data on the
+   * physical layer. Safe to call from an interrupt.
+   */
+  void notifyReady() override;
+
+  /**
+   * @brief Lets the physical layer wake the datalink when data arrives. The
+   * physical layer is then no longer polled for readable data.
+   * @param notifier The physical layer given in the constructor.
+   */
+  void listenTo(physical::ReadyNotifier &notifier);
+
+  using DatalinkI::transmitDataframe;
   bool transmitDataframe(const DataPacket &dataframe) override;
 
+  /// @returns the number of bytes that can still be queued for transmission.
   size_t getBufferFreeSpace() const;
 
   bool isChannelBlocked() const override;
@@ -102,6 +366,92 @@ public:
   size_t getMaxPacketSize() const override;
 
 private:
+  /**
+   * @brief Reads the next header or data chunk from the physical layer.
+   * @returns the number of bytes read.
+   */
+  size_t receiveFromPhysical();
+
+  /**
+   * @brief Writes the next header or data chunk of the transmit queue to the
+   * physical layer.
+   * @param budget Maximum number of bytes to write.
+   * @returns the number of bytes written.
+   */
+  size_t transmitToPhysical(size_t budget);
+
+  /// @returns the bytes a command adds to its data on the physical layer.
+  size_t getCommandOverhead(PhysicalHeader command) const;
+
+  /// @returns the command frame data is sent with. DATA_LONG for large frames
+  /// with header framing.
+  PhysicalHeader getDataCommand() const;
+
+  /**
+   * @brief Writes a long data command with the next size bytes of the frame
+   * being transmitted. The bytes are written from the buffer without copying.
+   * @returns the number of bytes written.
+   */
+  size_t writeLongData(size_t size);
+
+  /**
+   * @brief Writes a command to the physical layer using the current framing.
+   * A data command carries the next bytes of the frame being transmitted.
+   * @param size Number of frame bytes to send with a data command.
+   * @returns the number of bytes written.
+   */
+  size_t writeCommand(PhysicalHeader command, size_t size = 0);
+
+  /**
+   * @brief Reads COBS records from the physical layer and handles each
+   * complete one.
+   * @returns the number of bytes read.
+   */
+  size_t receiveCobs();
+
+  /// Updates the medium state for a received command.
+  void handleCommand(PhysicalHeader command);
+
+  /// Restarts the release timeout and measures the gap since the last
+  /// received command.
+  void noteReceive();
+
+  /// Updates the adaptive release timeout with the largest gap of a window.
+  void updateReleaseTime(int64_t gap);
+
+  /// Adds received data to the frame being received.
+  void receiveData(const uint8_t *data, size_t size);
+
+  /// Checks the frame being received and makes it ready to be published.
+  void finishFrame();
+
+  /// Hands all complete received frames to the receive handlers.
+  void publishFrames();
+
+  /// Starts sending the next frame of transmitBuffer_.
+  void loadTransmitFrame();
+
+  /// @returns true if the next queued frame can go in the current window.
+  bool canAggregate();
+
+  /// Removes the frame being sent from transmitBuffer_ once it is done with.
+  void popTransmitFrame();
+
+  /**
+   * @returns true if the medium may be blocked now. Starts a backoff if CSMA
+   * is enabled and none is running.
+   */
+  bool backoffElapsed();
+
+  /**
+   * @brief Handles another node using the medium. Stops an own window or
+   * backoff. An interrupted frame is sent again when using CSMA.
+   */
+  void mediumTaken();
+
+  /// @returns a random number smaller than range.
+  uint32_t random(uint32_t range);
+
   /**
    * @brief Checks the IO if it has data to read.
    */
@@ -113,11 +463,65 @@ private:
   void taskInit() override;
 
   /**
-   * @brief Reads and writes data to the physical layer.
+   * @brief Reads all available data from the physical layer and writes to it.
    */
   void taskThread() override;
 };
 
+/**
+ * @brief   Datalink with buffers for frames up to dataLinkMaxFrameLength. Stays
+ * wire compatible with links that do not support jumbo frames.
+ */
+class Datalink : public DatalinkBase {
+private:
+  uint8_t transmitStorage_[transmitBufferSize];
+  uint8_t receiveStorage_[dataLinkBufferSize];
+
+public:
+  /**
+   * @brief Constructor. This requires an IO interface of an object, usually a
+   * physical layer but can be a topic offering this interface.
+   * @note The physical layer is simply a medium to transfer raw data, this can
+   * be a LoRa device like SX1280 or UART, SPI etc.
+   * @param physicalLayerDevice The object used as the physical layer.
+   */
+  Datalink(HAL::DigitalIO &physicalLayerDevice,
+           Core::Scheduler &scheduler = Core::getSystemScheduler());
+};
+
+/**
+ * @brief   Datalink with storage for frames up to the given length. For fast
+ * wired links like SPI or USB where the overhead of small frames dominates.
+ * @tparam MAXFRAMELENGTH Largest frame sent or received.
+ * @tparam NUMFRAMES Number of frames that can be buffered in each direction.
+ * The transmit queue holds half as many of priorities other than NORMAL.
+ */
+template <size_t MAXFRAMELENGTH, size_t NUMFRAMES = 2>
+class DatalinkJumbo : public DatalinkBase {
+  static_assert(MAXFRAMELENGTH <= maxJumboFrameLength,
+                "Frame, CRC and timestamp must fit into 16 bits.");
+
+public:
+  static constexpr size_t bufferSize =
+      NUMFRAMES *
+      (MAXFRAMELENGTH + crcTrailerSize + FrameRing::recordHeaderSize);
+  static constexpr size_t transmitBufferSize =
+      2 * NUMFRAMES *
+      (MAXFRAMELENGTH + crcTrailerSize + TransmitQueue::recordOverhead);
+
+private:
+  uint8_t transmitStorage_[transmitBufferSize];
+  uint8_t receiveStorage_[bufferSize];
+
+public:
+  DatalinkJumbo(HAL::DigitalIO &physicalLayerDevice,
+                Core::Scheduler &scheduler = Core::getSystemScheduler())
+      : DatalinkBase(physicalLayerDevice, transmitStorage_, transmitBufferSize,
+                     receiveStorage_, bufferSize, scheduler) {
+    setMaxFrameLength(MAXFRAMELENGTH);
+  }
+};
+
 } // namespace VCTR::network::datalink
 
 #endif
\ No newline at end of file
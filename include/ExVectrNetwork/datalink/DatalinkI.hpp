@@ -4,9 +4,26 @@
 #include "ExVectrCore/handler.hpp"
 
 #include "ExVectrNetwork/DataPacket.hpp"
+#include "ExVectrNetwork/PacketPool.hpp"
+#include "ExVectrNetwork/Priority.hpp"
+#include "ExVectrNetwork/datalink/TransmitQueue.hpp"
 
 namespace VCTR::network::datalink {
 
+/// Counts of received and dropped frames.
+struct ReceiveCounters {
+  /// Frames passed to the receive handlers.
+  uint32_t received = 0;
+  /// Frames dropped because the CRC did not match.
+  uint32_t crcErrors = 0;
+  /// Frames dropped because they were too long or too short.
+  uint32_t lengthErrors = 0;
+  /// Frames dropped because the receive buffer was full.
+  uint32_t overflows = 0;
+  /// Frames dropped because no packet storage was available.
+  uint32_t noStorage = 0;
+};
+
 /**
  * @brief Interface for the datalink layer. Inhereting classes must implement
  * the dataframeReceiveFunc function.
@@ -18,10 +35,22 @@ protected:
   /// @brief This handler group is called when a dataframe is received.
   Core::HandlerGroup<const VCTR::network::DataPacket &> receiveHandlers_;
 
+  /// @brief Pool dataframes are allocated from. Heap if nullptr.
+  PacketPool *packetPool_ = &getDefaultPacketPool();
+
 public:
   virtual bool
   transmitDataframe(const VCTR::network::DataPacket &dataframe) = 0;
 
+  /**
+   * @brief Transmits a dataframe made of multiple fragments.
+   * @note The fragments are only valid during the call. The default gathers
+   * them into a DataPacket. Override to write the fragments directly to the
+   * physical device.
+   * @return true if the dataframe was accepted.
+   */
+  virtual bool transmitDataframe(const VCTR::network::PacketChain &dataframe);
+
   /**
    * @brief Get the maximum packet size that can be transmitted by the datalink.
    * @note packets over this size will be dropped and not transmitted.
@@ -35,6 +64,18 @@ public:
    */
   virtual bool isChannelBlocked() const = 0;
 
+  /**
+   * @brief Sets how the next frame is picked from the priority queues.
+   * Strict by default. Does nothing on datalinks without priority queues.
+   */
+  virtual void setTransmitScheduling(TransmitScheduling scheduling);
+
+  /**
+   * @brief Sets the share of a priority class in weighted scheduling.
+   * @param weight At least 1. Defaults are 4, 2 and 1 from CONTROL to BULK.
+   */
+  virtual void setPriorityWeight(Priority priority, uint16_t weight);
+
   /**
    * @brief Adds a handler to be called when a dataframe is received.
    * @param handler The handler function to be added.
@@ -47,6 +88,13 @@ public:
    * @brief Clears all handlers that are called when a dataframe is received.
    */
   void clearReceiveHandlers();
+
+  /**
+   * @brief Sets the pool received dataframes are allocated from. Frames that
+   * do not fit into a slot or arrive while the pool is exhausted use the heap.
+   * @param pool The pool to use or nullptr to only use the heap.
+   */
+  void setPacketPool(PacketPool *pool);
 };
 
 } // namespace VCTR::network::datalink
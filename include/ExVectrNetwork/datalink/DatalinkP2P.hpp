@@ -0,0 +1,61 @@
+#ifndef EXVECTRNETWORK_DATALINKP2P_H_
+#define EXVECTRNETWORK_DATALINKP2P_H_
+
+#include "ExVectrHAL/digital_io.hpp"
+
+#include "ExVectrNetwork/datalink/DatalinkStream.hpp"
+
+namespace VCTR::network::datalink {
+
+/**
+ * @brief   Datalink for a point-to-point link where each direction has its own
+ * wire, like UART with separate TX and RX lines. There is no medium to
+ * arbitrate, so transmit and receive run at the same time and frames are sent
+ * as soon as they are queued.
+ * @note    Both ends must use DatalinkP2P. Use Datalink for shared media.
+ */
+class DatalinkP2P : public DatalinkStream {
+public:
+  ///@brief Sync byte, 16 bit length and a check byte over the length in front
+  /// of each frame.
+  static constexpr size_t frameHeaderSize = frameHeaderBaseSize;
+  ///@brief Size of the default transmit buffer in bytes. Holds five NORMAL
+  /// frames of defaultMaxFrameLength and half as many of the others. Queued
+  /// frames take their size plus TransmitQueue::recordOverhead.
+  static constexpr size_t defaultBufferSize =
+      2 * 5 * (defaultMaxFrameLength + TransmitQueue::recordOverhead);
+  ///@brief Default number of bytes read and written in a single run.
+  static constexpr size_t defaultByteBudget = 2 * defaultBufferSize;
+
+private:
+  ///@brief Storage of transmitBuffer_ unless other storage is given.
+  uint8_t transmitStorage_[defaultBufferSize];
+
+public:
+  /**
+   * @param physicalLayerDevice Full duplex IO to the other end.
+   * @param maxFrameLength Largest frame sent or received. At most
+   * TransmitQueue::maxFrameSize.
+   * Frames larger than defaultMaxFrameLength also need a larger transmit
+   * buffer, see setTransmitStorage().
+   */
+  DatalinkP2P(HAL::DigitalIO &physicalLayerDevice,
+              size_t maxFrameLength = defaultMaxFrameLength,
+              Core::Scheduler &scheduler = Core::getSystemScheduler());
+
+  /// @returns false. The link is never shared.
+  bool isChannelBlocked() const override;
+
+private:
+  /// Starts sending the next queued frame.
+  bool nextFrame() override;
+
+  /// Hands the frame to the receive handlers.
+  void frameReceived(const uint8_t *fields, DataPacket &frame) override;
+
+  void taskCheck() override;
+};
+
+} // namespace VCTR::network::datalink
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef EXVECTRNETWORK_DATALINKSTREAM_H_
+#define EXVECTRNETWORK_DATALINKSTREAM_H_
+
+#include "ExVectrCore/task_types.hpp"
+
+#include "ExVectrHAL/digital_io.hpp"
+
+#include "ExVectrNetwork/datalink/DatalinkI.hpp"
+#include "ExVectrNetwork/datalink/TransmitQueue.hpp"
+#include "ExVectrNetwork/physical/ReadyNotifier.hpp"
+
+namespace VCTR::network::datalink {
+
+/**
+ * @brief   Base of datalinks that send frames as a byte stream with a sync
+ * byte, a checked header and a CRC-16 in each frame. Handles the physical
+ * layer, the transmit buffer and parsing received frames. Derived classes add
+ * their fields to the header and decide when to send.
+ * @note    Use DatalinkP2P or DatalinkToken.
+ */
+class DatalinkStream : public DatalinkI,
+                       public Core::Task_Periodic,
+                       public physical::ReadyListener {
+public:
+  ///@brief Default maximum length a data frame can be.
+  static constexpr size_t defaultMaxFrameLength = 230;
+  ///@brief Starts every frame. The receiver searches for it after an error.
+  static constexpr uint8_t syncByte = 0x7E;
+  ///@brief Sync byte, 16 bit length and a check byte over the header in front
+  /// of each frame. Fields of the derived class go between sync and length.
+  static constexpr size_t frameHeaderBaseSize = 4;
+  ///@brief Largest number of header fields a derived class can add.
+  static constexpr size_t maxHeaderFields = 2;
+  ///@brief CRC-16 over everything after the sync byte behind each frame.
+  static constexpr size_t frameTrailerSize = 2;
+
+private:
+  enum class ReceiveState { SYNC, HEADER, DATA, TRAILER };
+
+  ///@brief Number of header fields between the sync byte and the length.
+  size_t headerFields_ = 0;
+
+  ///@brief If a frame is being sent.
+  bool transmitting_ = false;
+  ///@brief If the frame being sent is the one taken from transmitBuffer_.
+  bool transmitQueued_ = false;
+  ///@brief Header of the frame being sent.
+  uint8_t transmitHeader_[frameHeaderBaseSize + maxHeaderFields];
+  ///@brief Data of the frame being sent if it is not queued.
+  const uint8_t *transmitData_ = nullptr;
+  ///@brief Data length of the frame being sent.
+  size_t transmitLength_ = 0;
+  uint8_t transmitTrailer_[frameTrailerSize];
+  ///@brief Index of the next byte to send, counted from the frame header.
+  size_t transmitOffset_ = 0;
+
+  ReceiveState receiveState_ = ReceiveState::SYNC;
+  ///@brief Header bytes after the sync byte. Parsed again if the check byte
+  /// is wrong, as the real sync byte may be among them.
+  uint8_t receiveHeader_[frameHeaderBaseSize - 1 + maxHeaderFields];
+  ///@brief Length of the frame being received.
+  size_t receiveLength_ = 0;
+  ///@brief Number of header, data or trailer bytes received in the current
+  /// state.
+  size_t receiveOffset_ = 0;
+  ///@brief CRC-16 of the frame being received so far.
+  uint16_t receiveCrc_ = 0;
+  ///@brief The frame being received. Data is read straight into it.
+  DataPacket receiveFrame_;
+  ///@brief If the frame being received had no storage and is skipped.
+  bool receiveDiscard_ = false;
+
+protected:
+  ///@brief The physical layer that offers IO interface for reading/writing.
+  HAL::DigitalIO *physicalLayer_ = nullptr;
+
+  ///@brief Set by notifyReady(), possibly from an interrupt. Cleared when the
+  /// datalink runs.
+  volatile bool wakeupPending_ = false;
+  ///@brief If the physical layer must be polled for new data. False if it
+  /// notifies.
+  bool pollPhysical_ = true;
+
+  ///@brief Maximum number of bytes read and written in a single run.
+  size_t byteBudget_ = 0;
+  ///@brief Larger frames are not sent and dropped when received.
+  size_t maxFrameLength_ = defaultMaxFrameLength;
+
+  ///@brief Payloads of the frames to transmit, queued by priority.
+  TransmitQueue transmitBuffer_;
+
+  ///@brief When bytes were last read from the physical layer.
+  int64_t lastActivity_ = 0;
+  ReceiveCounters receiveCounters_;
+
+  /**
+   * @param name Name of the task.
+   * @param physicalLayerDevice IO to send and receive the frames on.
+   * @param headerFields Number of header fields the derived class adds. At
+   * most maxHeaderFields.
+   * @param transmitStorage Storage for frames queued for transmission. Must
+   * outlive the datalink.
+   * @param transmitSize Size of transmitStorage in bytes.
+   * @param maxFrameLength Largest frame sent or received. At most
+   * TransmitQueue::maxFrameSize.
+   * @param byteBudget Maximum number of bytes read and written in a run.
+   */
+  DatalinkStream(const char *name, HAL::DigitalIO &physicalLayerDevice,
+                 size_t headerFields, uint8_t *transmitStorage,
+                 size_t transmitSize, size_t maxFrameLength,
+                 size_t byteBudget, Core::Scheduler &scheduler);
+
+public:
+  /**
+   * @brief Sets how many bytes a single run may read and write.
+   * @param bytes Maximum number of bytes per run. At least 1.
+   */
+  void setByteBudget(size_t bytes);
+
+  /**
+   * @brief Queues frames to transmit in the given storage instead of the
+   * default buffer. Frames already queued are dropped.
+   * @param storage Memory for queued frames. Must outlive the datalink.
+   * @param size Size of the storage in bytes.
+   */
+  void setTransmitStorage(uint8_t *storage, size_t size);
+
+  void setTransmitScheduling(TransmitScheduling scheduling) override;
+
+  void setPriorityWeight(Priority priority, uint16_t weight) override;
+
+  /// @returns the counts of received and dropped frames.
+  const ReceiveCounters &getReceiveCounters() const;
+
+  void resetReceiveCounters();
+
+  /**
+   * @brief Wakes the datalink on the next scheduler pass to handle data on the
+   * physical layer. Safe to call from an interrupt.
+   */
+  void notifyReady() override;
+
+  /**
+   * @brief Lets the physical layer wake the datalink when data arrives. The
+   * physical layer is then no longer polled for readable data.
+   * @param notifier The physical layer given in the constructor.
+   */
+  void listenTo(physical::ReadyNotifier &notifier);
+
+  using DatalinkI::transmitDataframe;
+  bool transmitDataframe(const DataPacket &dataframe) override;
+
+  size_t getMaxPacketSize() const override;
+
+protected:
+  /**
+   * @brief Starts sending the next frame of transmitBuffer_. It is removed
+   * once sent.
+   * @param fields Header fields of the derived class.
+   */
+  void sendQueuedFrame(const uint8_t *fields);
+
+  /**
+   * @brief Starts sending a frame with the given data.
+   * @param fields Header fields of the derived class.
+   * @param data Must stay unchanged until the frame is sent.
+   */
+  void sendFrame(const uint8_t *fields, const uint8_t *data, size_t length);
+
+  /// @returns true while a frame is being sent.
+  bool isTransmitting() const;
+
+  /// @returns true while a frame is being received.
+  bool isReceiving() const;
+
+  /// Drops the frame being received, for example after its sender went silent.
+  void abortReceive();
+
+  /**
+   * @brief Called when no frame is being sent. Start the next one here with
+   * sendQueuedFrame() or sendFrame().
+   * @returns true if a frame was started.
+   */
+  virtual bool nextFrame() = 0;
+
+  /// Called once the frame started last is completely written.
+  virtual void frameSent() {}
+
+  /**
+   * @brief Called for each received header with a correct check byte.
+   * @param fields Header fields of the derived class.
+   * @param length Data length of the frame. Checked against maxFrameLength_.
+   * @returns false to drop the frame.
+   */
+  virtual bool checkHeader(const uint8_t *fields, size_t length) {
+    return true;
+  }
+
+  /**
+   * @brief Called for each received frame with a correct CRC.
+   * @param fields Header fields of the derived class.
+   * @param frame The received frame with its timestamp set.
+   */
+  virtual void frameReceived(const uint8_t *fields, DataPacket &frame) = 0;
+
+  /// Called between receiving and transmitting to update the medium access.
+  virtual void updateAccess() {}
+
+  void taskInit() override;
+
+  /**
+   * @brief Receives and transmits until nothing is left or the byte budget is
+   * used up.
+   */
+  void taskThread() override;
+
+private:
+  /// Fills in the header and trailer of the frame to send.
+  void loadTransmitFrame(const uint8_t *fields);
+
+  /**
+   * @brief Writes the next part of the current frame to the physical layer.
+   * @param budget Maximum number of bytes to write.
+   * @returns the number of bytes written.
+   */
+  size_t transmitToPhysical(size_t budget);
+
+  /**
+   * @brief Reads from the physical layer and parses the frames in it.
+   * @param budget Maximum number of bytes to read.
+   * @returns the number of bytes read.
+   */
+  size_t receiveFromPhysical(size_t budget);
+
+  /// Parses received bytes.
+  void parse(const uint8_t *data, size_t size);
+
+  /**
+   * @brief Checks the received header and allocates storage for the frame.
+   * A header with a wrong check byte is parsed again for a sync byte.
+   */
+  void beginFrame();
+
+  /// Checks the received frame and hands it to the derived class.
+  void finishFrame();
+};
+
+} // namespace VCTR::network::datalink
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef EXVECTRNETWORK_DATALINKTOKEN_H_
+#define EXVECTRNETWORK_DATALINKTOKEN_H_
+
+#include "ExVectrCore/time_definitions.hpp"
+
+#include "ExVectrHAL/digital_io.hpp"
+
+#include "ExVectrNetwork/datalink/DatalinkStream.hpp"
+
+namespace VCTR::network::datalink {
+
+/**
+ * @brief   Datalink for shared buses that passes a token between a fixed set
+ * of stations. Only the holder of the token transmits, so there are no
+ * collisions and every station gets its share of the bus. A station waits at
+ * most one token rotation before it can send.
+ * @note    All stations on the bus must use DatalinkToken with the same number
+ * of stations and unique station numbers.
+ */
+class DatalinkToken : public DatalinkStream {
+public:
+  ///@brief Sync byte, type, source station, 16 bit length and a check byte
+  /// over the header in front of each frame.
+  static constexpr size_t frameHeaderSize = frameHeaderBaseSize + 2;
+  ///@brief Size of the default transmit buffer in bytes. Holds five NORMAL
+  /// frames of defaultMaxFrameLength and half as many of the others. Queued
+  /// frames take their size plus TransmitQueue::recordOverhead.
+  static constexpr size_t defaultBufferSize =
+      2 * 5 * (defaultMaxFrameLength + TransmitQueue::recordOverhead);
+  ///@brief Default number of bytes read and written in a single run.
+  static constexpr size_t defaultByteBudget = 2 * defaultBufferSize;
+
+  /// Counts of token events.
+  struct TokenCounters {
+    /// Tokens received from another station.
+    uint32_t received = 0;
+    /// Tokens passed on.
+    uint32_t passed = 0;
+    /// Successors skipped because they did not answer.
+    uint32_t skipped = 0;
+    /// Tokens created after the bus was idle for too long.
+    uint32_t regenerated = 0;
+    /// Tokens given up because another station held one too.
+    uint32_t duplicates = 0;
+  };
+
+private:
+  enum class FrameType : uint8_t { DATA = 0, TOKEN = 1 };
+
+  ///@brief Storage of transmitBuffer_ unless other storage is given.
+  uint8_t transmitStorage_[defaultBufferSize];
+
+  ///@brief Number of this station. 0 to numStations_ - 1.
+  uint8_t station_ = 0;
+  ///@brief Number of stations on the bus.
+  uint8_t numStations_ = 1;
+  ///@brief How long the token may be held for sending frames.
+  int64_t tokenHoldTime_ = 10 * Core::MILLISECONDS;
+  ///@brief How long a successor has to start sending after getting the token.
+  int64_t passTimeout_ = 5 * Core::MILLISECONDS;
+  ///@brief How long the bus must be idle before the token counts as lost.
+  int64_t lossTimeout_ = 20 * Core::MILLISECONDS;
+
+  ///@brief If this station holds the token.
+  bool holdingToken_ = false;
+  ///@brief When the token was received.
+  int64_t holdStart_ = 0;
+  ///@brief If the token was passed and the successor has not been heard yet.
+  bool awaitingSuccessor_ = false;
+  ///@brief Station the token is passed to.
+  uint8_t successor_ = 0;
+  ///@brief When the token was passed.
+  int64_t passTime_ = 0;
+  TokenCounters tokenCounters_;
+
+  ///@brief If the frame being sent is a token.
+  bool sendingToken_ = false;
+  ///@brief Data of a token frame. The station it is passed to.
+  uint8_t transmitToken_ = 0;
+
+public:
+  /**
+   * @param physicalLayerDevice IO to the shared bus.
+   * @param station Number of this station. Unique on the bus and smaller than
+   * numStations. Station 0 creates the first token.
+   * @param numStations Number of stations on the bus.
+   * @param maxFrameLength Largest frame sent or received. At most
+   * TransmitQueue::maxFrameSize.
+   * Frames larger than defaultMaxFrameLength also need a larger transmit
+   * buffer, see setTransmitStorage().
+   */
+  DatalinkToken(HAL::DigitalIO &physicalLayerDevice, uint8_t station,
+                uint8_t numStations,
+                size_t maxFrameLength = defaultMaxFrameLength,
+                Core::Scheduler &scheduler = Core::getSystemScheduler());
+
+  /**
+   * @brief Sets how long the token may be held for sending. A frame started
+   * in time is finished, so the token is held for at most this plus one frame.
+   * Worst case latency is about the number of stations times this.
+   */
+  void setTokenHoldTime(int64_t time);
+
+  /**
+   * @brief Sets how fast a lost token or dead station is detected.
+   * @param passTimeout How long a successor has to start sending after being
+   * passed the token. It is skipped otherwise. Should be a few times the
+   * time a station needs to react. A frame pausing for longer is dropped.
+   * @param lossTimeout How long the bus must be idle until the token counts as
+   * lost. Each station waits passTimeout longer than the one before, so the
+   * lowest station creates the new token.
+   */
+  void setTokenTimeouts(int64_t passTimeout, int64_t lossTimeout);
+
+  /// @returns true if this station holds the token.
+  bool hasToken() const;
+
+  /// @returns the counts of token events.
+  const TokenCounters &getTokenCounters() const;
+
+  /// Resets the token and receive counters.
+  void resetCounters();
+
+  /// @returns true while another station holds the token.
+  bool isChannelBlocked() const override;
+
+private:
+  /// Sends the next queued frame while the hold time lasts, then the token.
+  bool nextFrame() override;
+
+  /// Waits for the successor after passing the token.
+  void frameSent() override;
+
+  /// Drops headers from unknown stations or with a bad length.
+  bool checkHeader(const uint8_t *fields, size_t length) override;
+
+  /// Takes a token passed to this station or hands on a data frame.
+  void frameReceived(const uint8_t *fields, DataPacket &frame) override;
+
+  /**
+   * @brief Checks the token timeouts and takes over the token if needed.
+   * Drops a partial frame after a silence.
+   */
+  void updateAccess() override;
+
+  /// @returns the station after the given one.
+  uint8_t nextStation(uint8_t station) const;
+
+  void taskCheck() override;
+
+  void taskInit() override;
+};
+
+} // namespace VCTR::network::datalink
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef EXVECTRNETWORK_TRANSMITQUEUE_H_
+#define EXVECTRNETWORK_TRANSMITQUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ExVectrNetwork/DataPacket.hpp"
+#include "ExVectrNetwork/FrameRing.hpp"
+#include "ExVectrNetwork/Priority.hpp"
+
+namespace VCTR::network::datalink {
+
+/// How the next frame is picked from the queues of the priority classes.
+enum class TransmitScheduling {
+  /// Always the most urgent class waiting. Lower classes may starve.
+  STRICT,
+  /// Each class gets a share of the sent bytes given by its weight.
+  WEIGHTED
+};
+
+/**
+ * @brief   Frames waiting to be transmitted, queued per priority class.
+ * @details Each class has its own FrameRing in a part of the given storage:
+ * a quarter for CONTROL, half for NORMAL and a quarter for BULK. A bulk
+ * backlog therefore never takes the space of control frames. Frames are
+ * copied in with their timestamp in front, so each takes its size plus
+ * recordOverhead bytes.
+ *
+ * The frame to send is taken with take() and stays taken until release(),
+ * so it can be read in parts or sent again. Frames queued meanwhile do not
+ * change it, even if they are more urgent.
+ *
+ * Weighted scheduling is a deficit round robin. Each round a class may send
+ * quantum times its weight bytes, so large bulk frames cannot take more than
+ * their share and a queued control frame waits for at most one round.
+ * Use TransmitQueueStatic to create a queue with its own storage.
+ * @note Not interrupt safe. Only use from scheduler tasks.
+ */
+class TransmitQueue {
+public:
+  ///@brief Bytes of the timestamp stored in front of each frame.
+  static constexpr size_t timestampSize = sizeof(int64_t);
+  ///@brief Bytes each queued frame takes in addition to its size.
+  static constexpr size_t recordOverhead =
+      FrameRing::recordHeaderSize + timestampSize;
+  ///@brief Largest frame that fits into a FrameRing record with its timestamp.
+  static constexpr size_t maxFrameSize = UINT16_MAX - timestampSize;
+  ///@brief Bytes a class may send per round for each unit of weight.
+  static constexpr size_t quantum = 256;
+
+private:
+  ///@brief Frames of each class in sending order.
+  FrameRing rings_[numPriorities];
+  ///@brief Maximum number of frames queued in each class.
+  size_t capacity_ = SIZE_MAX;
+
+  ///@brief Class of the taken frame. numPriorities if none is taken.
+  size_t taken_ = numPriorities;
+  ///@brief Class of the frame started with begin().
+  size_t open_ = 0;
+
+  TransmitScheduling scheduling_ = TransmitScheduling::STRICT;
+  ///@brief Share of each class in weighted scheduling.
+  uint16_t weights_[numPriorities] = {4, 2, 1};
+  ///@brief Bytes each class may still send in the current round.
+  size_t deficits_[numPriorities] = {};
+  ///@brief Class served by the round robin.
+  size_t current_ = 0;
+
+public:
+  /**
+   * @param storage Memory for the frames of all classes. Must outlive the
+   * queue.
+   * @param size Size of the storage in bytes.
+   */
+  TransmitQueue(uint8_t *storage, size_t size);
+
+  TransmitQueue(const TransmitQueue &) = delete;
+  TransmitQueue &operator=(const TransmitQueue &) = delete;
+
+  /**
+   * @brief Moves the queue to other storage. All frames are removed.
+   * @param storage Memory for the frames of all classes. Must outlive the
+   * queue.
+   * @param size Size of the storage in bytes.
+   */
+  void setStorage(uint8_t *storage, size_t size);
+
+  /**
+   * @brief Queues a copy of the frame behind the others of its class.
+   * @returns false if there is not enough space. Nothing is queued then.
+   */
+  bool push(const DataPacket &frame);
+
+  /**
+   * @brief Starts a frame of the given size at the back of its class. Add
+   * its bytes with append() and finish it with commit().
+   * @param size Number of bytes that will be appended.
+   * @returns false if there is not enough space.
+   */
+  bool begin(Priority priority, size_t size, int64_t timestamp);
+
+  /// Adds bytes to the frame started with begin().
+  void append(const uint8_t *data, size_t size);
+
+  /// Makes the frame started with begin() available for sending.
+  void commit();
+
+  /**
+   * @brief Takes the next frame to send. It stays taken until release(),
+   * also if more urgent frames are queued meanwhile.
+   * @returns false if the queue is empty.
+   */
+  bool take();
+
+  /// @returns true if a frame was taken and not yet released.
+  bool hasTaken() const { return taken_ < numPriorities; }
+
+  /// @returns the size of the taken frame. 0 if none is taken.
+  size_t takenSize() const;
+
+  /// @returns the timestamp the taken frame was queued with.
+  int64_t takenTimestamp() const;
+
+  /**
+   * @brief Gives part of the taken frame without copying it. A frame that
+   * wraps around the end of its storage is given in two parts.
+   * @param offset Index of the first byte in the frame.
+   * @param size Set to the number of bytes that follow in the storage. 0 at
+   * the frame end.
+   * @returns a pointer to the byte at offset.
+   */
+  const uint8_t *peekTaken(size_t offset, size_t &size) const;
+
+  /**
+   * @brief Copies part of the taken frame into the given buffer.
+   * @returns the number of bytes copied. Less than size at the frame end.
+   */
+  size_t readTaken(size_t offset, uint8_t *buffer, size_t size) const;
+
+  /// Removes the taken frame. It counts as sent for weighted scheduling.
+  void release();
+
+  /**
+   * @returns the size of the frame take() gives next. The taken frame if
+   * there is one. 0 if empty.
+   */
+  size_t frontSize();
+
+  /// @returns the number of frames in all classes, including the taken one.
+  size_t size() const;
+
+  /// @returns the largest frame of the given class that can still be queued.
+  size_t freeSpace(Priority priority) const;
+
+  /// @returns true if no frame of the given class can be queued.
+  bool isFull(Priority priority) const { return freeSpace(priority) == 0; }
+
+  /// Removes all frames, including the taken one.
+  void clear();
+
+  /**
+   * @brief Limits the number of frames queued in each class, on top of the
+   * space they take. Unlimited by default.
+   * @param frames At least 1.
+   */
+  void setCapacity(size_t frames) { capacity_ = frames < 1 ? 1 : frames; }
+
+  size_t getCapacity() const { return capacity_; }
+
+  void setScheduling(TransmitScheduling scheduling) {
+    scheduling_ = scheduling;
+  }
+
+  /**
+   * @brief Sets the share of a class in weighted scheduling.
+   * @param weight At least 1. A class with twice the weight sends twice as
+   * many bytes while both have frames waiting.
+   */
+  void setWeight(Priority priority, uint16_t weight) {
+    weights_[index(priority)] = weight < 1 ? 1 : weight;
+  }
+
+private:
+  static size_t index(Priority priority) {
+    auto i = static_cast<size_t>(priority);
+    return i < numPriorities ? i : numPriorities - 1;
+  }
+
+  /// @returns the class to send from next. Calling it again gives the same.
+  size_t select();
+};
+
+/**
+ * @brief Transmit queue with storage for the given number of bytes.
+ * @tparam SIZE Size of the storage in bytes, shared by the classes as
+ * described in TransmitQueue.
+ */
+template <size_t SIZE> class TransmitQueueStatic : public TransmitQueue {
+private:
+  uint8_t storage_[SIZE];
+
+public:
+  TransmitQueueStatic() : TransmitQueue(storage_, SIZE) {}
+};
+
+} // namespace VCTR::network::datalink
+
+#endif
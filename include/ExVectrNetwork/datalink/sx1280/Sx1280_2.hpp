@@ -10,12 +10,19 @@
 
 #include "ExVectrNetwork/DataPacket.hpp"
 #include "ExVectrNetwork/datalink/RadioI.hpp"
+#include "ExVectrNetwork/datalink/TransmitQueue.hpp"
 #include "ExVectrNetwork/physical/HasChannels.hpp"
 
 #include "Sx1280_Settings.hpp"
 
 #include "sx12xxAL/src/SX128XLT.h"
 
+/// Number of frames of each priority the SX1280 driver can queue for
+/// transmission.
+#ifndef EXVECTRNETWORK_SX1280_TX_QUEUE_SIZE
+#define EXVECTRNETWORK_SX1280_TX_QUEUE_SIZE 8
+#endif
+
 namespace VCTR::network::datalink {
 
 /**
@@ -27,28 +34,51 @@ namespace VCTR::network::datalink {
  *  - When IRQ_RX_DONE fires the packet is read from the buffer and dispatched.
  *  - To transmit: the radio is moved to STDBY, the packet is loaded, TX is
  *    started, and on TX_DONE the radio goes straight back to continuous RX.
+ *  - Frames sent while the radio is busy are queued and sent back-to-back,
+ *    most urgent priority first.
  *  - No CAD is used.
  *  - Frequency / modulation parameter changes are applied by restarting RX.
  */
 class Datalink_SX1280_V2 : public VCTR::network::datalink::RadioI,
                            public Core::Scheduler::Task {
 public:
+  /// Maximum number of frames of each priority waiting for the radio.
+  static constexpr size_t kTxQueueSize = EXVECTRNETWORK_SX1280_TX_QUEUE_SIZE;
+
+  /// Counts of the transmit queue.
+  struct TxQueueCounters {
+    /// Frames put into the queue because the radio was busy.
+    uint32_t queued = 0;
+    /// Frames refused because the queue was full.
+    uint32_t dropped = 0;
+    /// Most frames waiting at once.
+    uint16_t maxFill = 0;
+  };
+
   Datalink_SX1280_V2(SX128XLT &sx1280Driver);
 
   // --- Getters ---------------------------------------------------------------
+  // Averaged over the last packets. Each received DataPacket carries its own
+  // values in DataPacket::metadata.
   int16_t lastPacketRSSI() const { return receivedDataRSSI; }
   int16_t lastPacketSNR() const { return receivedDataSNR; }
+  /// Counts of received frames and frames dropped for lack of storage.
+  const ReceiveCounters &getReceiveCounters() const { return receiveCounters; }
+  void resetReceiveCounters() { receiveCounters = ReceiveCounters(); }
 
   // --- RadioI / DatalinkI overrides ------------------------------------------
   size_t getMaxPacketSize() const override;
   bool isChannelBlocked() const override;
   bool transmitDataframe(const DataPacket &dataframe) override;
+  bool transmitDataframe(const PacketChain &dataframe) override;
   size_t getNumChannels() const override;
   size_t getCurrentChannel() const override;
   void setChannel(size_t channel) override;
   void setStartReceive(bool rxEnabled) override;
   void setEnableTxRx(bool enable) override;
   void setEnableAutoRx(bool enableAutoRx) override;
+  void setTransmitScheduling(TransmitScheduling scheduling) override;
+  void setPriorityWeight(Priority priority, uint16_t weight) override;
 
   // --- Configuration ---------------------------------------------------------
   void setFrequency(uint32_t newFreqHz);
@@ -75,6 +105,19 @@ public:
   /// Sets the dB the external PA adds to the output power.
   void setPAdbm(uint8_t paDbm);
 
+  // --- TX queue --------------------------------------------------------------
+  /**
+   * @brief Limits the number of frames of each priority waiting for the
+   * radio. Bursts up to this long are sent without loss.
+   * @param depth 1 to kTxQueueSize.
+   */
+  void setTxQueueDepth(size_t depth);
+  size_t getTxQueueDepth() const { return txQueue.getCapacity(); }
+  /// Number of frames waiting for the radio.
+  size_t getTxQueueFill() const { return txQueue.size(); }
+  const TxQueueCounters &getTxQueueCounters() const { return txQueueCounters; }
+  void resetTxQueueCounters() { txQueueCounters = TxQueueCounters(); }
+
   uint16_t getRemainIrqFlags() const { return irqStatusRemain; }
   void clearRemainIrqFlags() { irqStatusRemain = 0; }
 
@@ -98,6 +141,9 @@ public:
 private:
   // --- Constants -------------------------------------------------------------
   static constexpr size_t kMaxFrameLength = 128;
+  // Each priority gets its own part of the queue, NORMAL half of it.
+  static constexpr size_t kTxQueueBytes =
+      2 * kTxQueueSize * (kMaxFrameLength + TransmitQueue::recordOverhead);
 
   static constexpr uint8_t kNumChannels = 20;
   static constexpr uint32_t kMinFreq = 2425000000UL;
@@ -150,15 +196,16 @@ private:
   int64_t txPrepareLeadTime = 3 * Core::MILLISECONDS;
 
   // --- TX pending data ----------------------------------
-  uint8_t txBuffer[kMaxFrameLength];
-  size_t txPendingSize = 0;
+  // Frames are copied in, so the sender's storage is released right away.
+  TransmitQueueStatic<kTxQueueBytes> txQueue;
+  TxQueueCounters txQueueCounters;
   size_t sxTxPendingSize = 0;
-  int64_t pendingTxTime = 0;
   int64_t txScheduledTime = 0;
 
   // --- Last-receive stats ----------------------------------------------------
   int16_t receivedDataRSSI = 0;
   int16_t receivedDataSNR = 0;
+  ReceiveCounters receiveCounters;
 
   // --- TX power settings -----------------------------------------------------
   int8_t txPower = 0;
@@ -215,6 +262,25 @@ private:
    */
   void prepareTx(const uint8_t *data, size_t size, int64_t txStart = 0);
 
+  /**
+   * Same as above, but writes each fragment of the chain directly into the
+   * radio buffer.
+   */
+  void prepareTx(const PacketChain &chain, int64_t txStart = 0);
+
+  /**
+   * Writes all fragments of the chain into the open radio buffer.
+   */
+  void writeChain(const PacketChain &chain);
+
+  /**
+   * Calls prepareTx() with the next queued frame and releases it afterwards.
+   */
+  void prepareTxPending();
+
+  /// Counts a frame put into the queue.
+  void countTxQueued();
+
   /**
    * Starts the transmission the that been prepared by prepareTx().
    * Will not wait till the txStart.
@@ -9,6 +9,7 @@
 #include "ExVectrHAL/pin_gpio.hpp"
 
 #include "ExVectrNetwork/DataPacket.hpp"
+#include "ExVectrNetwork/PacketPool.hpp"
 #include "ExVectrNetwork/physical/HasChannels.hpp"
 
 #include "Sx1280_Settings.hpp"
@@ -80,6 +81,12 @@ public:
   uint8_t *getTxBufferPtr();
   uint8_t getTxBufferSize() const;
 
+  /**
+   * @brief Sets the pool received packets are allocated from.
+   * @param pool The pool to use or nullptr to only use the heap.
+   */
+  void setPacketPool(PacketPool *pool);
+
   // --- HasChannels overrides -------------------------------------------------
   size_t getNumChannels() const override;
   size_t getCurrentChannel() const override;
@@ -4,12 +4,14 @@
 #include "ExVectrCore/list.hpp"
 #include "ExVectrCore/list_buffer.hpp"
 
+#include "ExVectrNetwork/Crc.hpp"
 #include "ExVectrNetwork/DataPacket.hpp"
+#include "ExVectrNetwork/PacketLayout.hpp"
 
 namespace VCTR::network::network {
 
-/// @brief   Network packet structure version. Added to the checksum.
-static constexpr uint8_t networkVersion = 2;
+/// @brief   Network packet structure version. Added to the CRC.
+static constexpr uint8_t networkVersion = 3;
 
 enum class NetworkPacketType : uint8_t {
   DATA,     // Packet data is for the application layer.
@@ -21,13 +23,27 @@ enum class NetworkPacketType : uint8_t {
 
 /**
  * @brief   Network packet structure.
- * @note    Raw data structure follows this format: [type, hops, dstAddress,
- * srcAddress, checksum, dataLength, data...] Usually only packet hops,
- * dstAddress, payloadLength and payload are used by the application layer. The
- * rest is handled by the network layer.
+ * @note    Raw data structure follows this format: [data..., type, hops,
+ * dstAddress, srcAddress, crc] Usually only packet hops, dstAddress and payload
+ * are used by the application layer. The rest is handled by the network layer.
+ * The CRC covers the whole frame, so corrupted payloads are rejected by the
+ * network layer before they are handed to anyone.
  */
-class NetworkPacketHeader : public PacketHeaderI {
+class NetworkPacketHeader : public PacketHeader<NetworkPacketHeader> {
+  friend PacketHeader<NetworkPacketHeader>;
+
+  /// Byte layout of the header.
+  struct Layout {
+    using Type = layout::Field<NetworkPacketType, 0>;
+    using Hops = layout::Field<uint8_t, Type::end>;
+    using DstAddress = layout::Field<uint16_t, Hops::end>;
+    using SrcAddress = layout::Field<uint16_t, DstAddress::end>;
+    using Crc = layout::Field<uint16_t, SrcAddress::end>;
+  };
+
 public:
+  static constexpr size_t headerSize = Layout::Crc::end;
+
   /// Packet type. What is this packet for?
   NetworkPacketType type = NetworkPacketType::DATA;
   /// Number of hops this packet can still take. Will be decremented by 1 each
@@ -37,17 +53,49 @@ public:
   uint16_t dstAddress;
   /// Source address. Who sent this?
   uint16_t srcAddress;
-  /// Checksum. Used to verify the integrity of the packet. Calculated as the
-  /// sum of all bytes in the packet only excluding the checksum byte plus
-  /// network version number.
-  uint8_t checksum;
+  /// CRC-16 of the network version, payload and all header bytes in front of
+  /// it. Calculated when the header is added.
+  uint16_t checksum;
 
 protected:
-  void serialize(uint8_t *buffer) const override;
-  bool deserialize(const uint8_t *buffer) override;
+  void serialize(uint8_t *buffer) const {
+    Layout::Type::write(buffer, type);
+    Layout::Hops::write(buffer, hops);
+    Layout::DstAddress::write(buffer, dstAddress);
+    Layout::SrcAddress::write(buffer, srcAddress);
+  }
 
-public:
-  size_t getHeaderSize() const override;
+  /// Writes the CRC over the payload and the header fields in front of it.
+  void seal(uint8_t *buffer, const PacketView *payload,
+            size_t numParts) const {
+    auto crc = seed();
+    for (size_t i = 0; i < numParts; i++)
+      crc = crc::crc16(payload[i].getPtr(), payload[i].size(), crc);
+    Layout::Crc::write(buffer, crc::crc16(buffer, Layout::Crc::offset, crc));
+  }
+
+  /// Checks the CRC over the whole frame.
+  bool check(const uint8_t *frame, size_t size) const {
+    // The CRC over the frame including the stored CRC is 0 if it is intact.
+    if (crc::crc16(frame, size, seed()) != 0) {
+      VRBS_MSG("Frame CRC failed! Size: %d \n", size);
+      return false;
+    }
+    return true;
+  }
+
+  bool deserialize(const uint8_t *buffer) {
+    type = Layout::Type::read(buffer);
+    hops = Layout::Hops::read(buffer);
+    dstAddress = Layout::DstAddress::read(buffer);
+    srcAddress = Layout::SrcAddress::read(buffer);
+    checksum = Layout::Crc::read(buffer);
+    return true;
+  }
+
+private:
+  /// CRC start value. Includes the version so other networks fail the check.
+  static uint16_t seed() { return crc::crc16(&networkVersion, 1); }
 };
 
 class NetworkPacket {
@@ -3,6 +3,7 @@
 
 #include "ExVectrCore/handler.hpp"
 
+#include "ExVectrNetwork/PacketView.hpp"
 #include "ExVectrNetwork/datalink/DatalinkI.hpp"
 #include "ExVectrNetwork/network/NetworkHeader.hpp"
 
@@ -17,8 +18,9 @@ protected:
   /// The address of this node.
   uint16_t nodeAddress_;
 
-  Core::HandlerGroup<const NetworkPacketHeader &,
-                     const Core::ListArray<uint8_t> &>
+  /// Handlers get a view of the payload inside the received frame. It is only
+  /// valid during the call.
+  Core::HandlerGroup<const NetworkPacketHeader &, const PacketView &>
       packetReceiveHandlers_;
 
 public:
@@ -46,11 +48,37 @@ public:
 
   /**
    * @brief Publish a network packet to be sent to the destination.
+   * @note Copies the payload into a new packet. Prefer the DataPacket overload
+   * when sending from a buffer that can be handed over.
    *
    * @param packet The packet to be sent.
    */
+  void sendPacket(const NetworkPacketHeader &header,
+                  const Core::ListArray<uint8_t> &payload = 0);
+
+  /**
+   * @brief Publish a network packet to be sent to the destination.
+   * @note The network header is appended to the given packet. Create the packet
+   * with enough tailroom (DataPacket::defaultTailroom) so this does not
+   * reallocate.
+   *
+   * @param header The network header to send the packet with.
+   * @param packet The packet to be sent. Is modified.
+   */
+  virtual void sendPacket(const NetworkPacketHeader &header,
+                          DataPacket &packet) = 0;
+
+  /**
+   * @brief Publish a network packet made of multiple fragments. The fragments
+   * are gathered as late as possible, ideally when written to the physical
+   * device.
+   * @note The network header is pushed into the chain.
+   *
+   * @param header The network header to send the packet with.
+   * @param chain The packet to be sent. Is modified.
+   */
   virtual void sendPacket(const NetworkPacketHeader &header,
-                          const Core::ListArray<uint8_t> &payload = 0) = 0;
+                          PacketChain &chain) = 0;
 
   /**
    * @brief Get the maximum packet size that can be transmitted by the network.
@@ -61,12 +89,13 @@ public:
 
   /**
    * @brief Adds a handler to be called when a network packet is received.
+   * @note The payload view points into the received frame and is only valid
+   * during the call.
    * @param handler The handler function to be added.
    */
   void addPacketReceiveHandler(
       Core::HandlerGroup<const NetworkPacketHeader &,
-                         const Core::ListArray<uint8_t> &>::HandlerFunction
-          handler);
+                         const PacketView &>::HandlerFunction handler);
 
   /**
    * @brief Clears all handlers that are called when a network packet is
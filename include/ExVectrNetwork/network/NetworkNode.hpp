@@ -7,6 +7,7 @@
 #include "ExVectrCore/topic.hpp"
 #include "ExVectrCore/topic_subscribers.hpp"
 
+#include "ExVectrNetwork/FixedList.hpp"
 #include "ExVectrNetwork/datalink/DatalinkI.hpp"
 #include "ExVectrNetwork/network/NetworkHeader.hpp"
 #include "ExVectrNetwork/network/NetworkI.hpp"
@@ -21,39 +22,68 @@ namespace VCTR::network::network {
  *          - Implement forwarding of packets.
  */
 class NetworkNode : public NetworkI, public Core::Task_Periodic {
+public:
+  /// Neighbours tracked by the constructors that allocate their own storage.
+  static constexpr size_t defaultMaxNeighbours = 32;
+  /// Datalinks supported by the constructors that allocate their own storage.
+  static constexpr size_t defaultMaxDatalinks = 4;
+
+protected:
+  struct NodeInfo {
+    uint16_t nodeAddress;
+    int64_t lastSeen;
+
+    // Checks if the nodes are the same. Ignores the lastSeen time.
+    bool operator==(const NodeInfo &other) const {
+      return nodeAddress == other.nodeAddress;
+    }
+  };
+
 private:
   /// Network version number. Used to calculate checksum and prevent
   /// incompatible networks from communicating.
-  static constexpr uint8_t networkVersion = 2;
+  static constexpr uint8_t networkVersion = 3;
 
-  Core::ListArray<datalink::DatalinkI *> datalinks_;
+  FixedList<datalink::DatalinkI *> datalinks_;
 
   /// If we havent heard from a node in this time, we consider it unreachable.
   /// Should be 4 times the sendInterval.
   int64_t timeoutInterval_ = 1 * Core::SECONDS;
   /// If the time since we last sent a packet is greater than this, we send a
-  /// heartbeat packet to show we are still connected.
-  int64_t sendInterval_ = 0.25 * Core::SECONDS;
+  /// heartbeat packet to show we are still connected. 0 to send none.
+  int64_t sendInterval_ = 0;
 
   /// The last time we sent a packet. Used to determine if we need to send a
   /// heartbeat packet.
   int64_t lastSend_ = 0;
 
-  struct NodeInfo {
-    uint16_t nodeAddress;
-    int64_t lastSeen;
-
-    // Checks if the nodes are the same. Ignores the lastSeen time.
-    bool operator==(const NodeInfo &other) const {
-      return nodeAddress == other.nodeAddress;
-    }
-  };
   /// @brief The list of nodes that this node can reach.
-  Core::ListArray<NodeInfo> nodeList_;
+  FixedList<NodeInfo> nodeList_;
+
+  /// True if the list storage was allocated by this node.
+  bool ownsStorage_ = false;
+
+protected:
+  /**
+   * @brief Construct a new Network Node object using the given storage. Used
+   * by NetworkNodeStatic.
+   *
+   * @param nodeAddress The address of this node.
+   * @param nodeStorage Storage for the list of reachable nodes.
+   * @param maxNeighbours Number of nodes nodeStorage can hold.
+   * @param datalinkStorage Storage for the list of datalinks.
+   * @param maxDatalinks Number of datalinks datalinkStorage can hold.
+   */
+  NetworkNode(uint16_t nodeAddress, NodeInfo *nodeStorage,
+              size_t maxNeighbours, datalink::DatalinkI **datalinkStorage,
+              size_t maxDatalinks, int64_t disconnectTimeout);
 
 public:
+#ifndef EXVECTRNETWORK_STATIC_ALLOCATION
   /**
    * @brief Construct a new Network Node object.
+   * @note Allocates storage for defaultMaxNeighbours and defaultMaxDatalinks
+   * once. Use NetworkNodeStatic to avoid the heap.
    *
    * @param nodeAddress The address of this node. Set to 0 to only receive
    * packets.
@@ -71,8 +101,12 @@ public:
    */
   NetworkNode(uint16_t nodeAddress, datalink::DatalinkI &datalink,
               int64_t disconnectTimeout = 1 * Core::SECONDS);
+#endif
+
+  NetworkNode(const NetworkNode &) = delete;
+  NetworkNode &operator=(const NetworkNode &) = delete;
 
-  //~NetworkNode();
+  ~NetworkNode();
 
   /**
    * @brief Checks if the given node is reachable.
@@ -87,17 +121,41 @@ public:
    * @brief Add a datalink layer to receive from.
    *
    * @param datalink The datalink layer to use.
+   * @return false if the maximum number of datalinks is reached.
    */
-  void addDatalink(datalink::DatalinkI &datalink);
+  bool addDatalink(datalink::DatalinkI &datalink);
+
+  /**
+   * @brief Sends a heartbeat to all nodes if nothing else was sent in the
+   * given interval. Keeps this node reachable for its neighbours while idle.
+   * Disabled by default, as each heartbeat takes airtime on every datalink.
+   *
+   * @param interval Time without sending before a heartbeat. Should be a
+   * quarter of the disconnect timeout of the other nodes. 0 to disable.
+   */
+  void setHeartbeatInterval(int64_t interval);
+
+  using NetworkI::sendPacket;
 
   /**
    * @brief Send a packet to the given destination address.
    *
-   * @param packet The packet to send.
-   * @param dstAddress The destination address.
+   * @param header The header containing the destination address.
+   * @param packet The packet to send. The network header is appended to it.
+   */
+  void sendPacket(const NetworkPacketHeader &header,
+                  DataPacket &packet) override;
+
+  /**
+   * @brief Send a fragmented packet to the given destination address.
+   * @note With a single datalink the fragments are handed down as is.
+   * Otherwise they are gathered once into a shared DataPacket.
+   *
+   * @param header The header containing the destination address.
+   * @param chain The packet to send. The network header is pushed into it.
    */
   void sendPacket(const NetworkPacketHeader &header,
-                  const Core::ListArray<uint8_t> &payload = 0) override;
+                  PacketChain &chain) override;
 
   /**
    * @brief Get the maximum packet size that can be transmitted by the network.
@@ -129,6 +187,53 @@ private:
   void taskThread() override;
 };
 
+/**
+ * @brief Network node with storage for the given number of neighbours and
+ * datalinks. Never allocates.
+ * @tparam MAXNEIGHBOURS Number of reachable nodes that can be tracked. Further
+ * nodes are ignored until others time out.
+ * @tparam MAXDATALINKS Number of datalinks that can be added.
+ */
+template <size_t MAXNEIGHBOURS, size_t MAXDATALINKS>
+class NetworkNodeStatic : public NetworkNode {
+private:
+  NodeInfo nodeStorage_[MAXNEIGHBOURS];
+  datalink::DatalinkI *datalinkStorage_[MAXDATALINKS];
+
+public:
+  /**
+   * @param nodeAddress The address of this node. Set to 0 to only receive
+   * packets.
+   */
+  NetworkNodeStatic(uint16_t nodeAddress,
+                    int64_t disconnectTimeout = 1 * Core::SECONDS)
+      : NetworkNode(nodeAddress, nodeStorage_, MAXNEIGHBOURS, datalinkStorage_,
+                    MAXDATALINKS, disconnectTimeout) {}
+
+  /**
+   * @param nodeAddress The address of this node. Set to 0 to only receive
+   * packets.
+   * @param datalink The datalink layer to use for sending and receiving
+   * packets.
+   */
+  NetworkNodeStatic(uint16_t nodeAddress, datalink::DatalinkI &datalink,
+                    int64_t disconnectTimeout = 1 * Core::SECONDS)
+      : NetworkNodeStatic(nodeAddress, disconnectTimeout) {
+    addDatalink(datalink);
+  }
+
+  /// @returns the number of bytes used by this node.
+  static constexpr size_t getMemorySize() { return sizeof(NetworkNodeStatic); }
+
+  /// Prints the memory used by this node.
+  void printMemoryReport() const {
+    LOG_MSG("NetworkNode: %d bytes. Neighbours: %d x %d bytes. Datalinks: %d "
+            "x %d bytes.\n",
+            int(getMemorySize()), int(MAXNEIGHBOURS), int(sizeof(NodeInfo)),
+            int(MAXDATALINKS), int(sizeof(datalink::DatalinkI *)));
+  }
+};
+
 } // namespace VCTR::network::network
 
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef EXVECTRNETWORK_READYNOTIFIER_HPP_
+#define EXVECTRNETWORK_READYNOTIFIER_HPP_
+
+namespace VCTR::network::physical {
+
+/**
+ * @brief Defines the interface for something that wants to be told when a
+ * physical layer has data to read, instead of polling it.
+ */
+class ReadyListener {
+public:
+  /**
+   * @brief Called by the physical layer when new data can be read.
+   * @note Can be called from an interrupt. Implementations must only set flags
+   * here and do the work later.
+   */
+  virtual void notifyReady() = 0;
+};
+
+/**
+ * @brief Physical layer that notifies a listener when new data arrived.
+ * @example A UART calling signalReady() from its RX interrupt.
+ */
+class ReadyNotifier {
+private:
+  ReadyListener *readyListener_ = nullptr;
+
+public:
+  /// Sets who to notify. nullptr to stop notifying.
+  void setReadyListener(ReadyListener *listener) { readyListener_ = listener; }
+
+protected:
+  /// Tells the listener that new data can be read.
+  void signalReady() {
+    if (readyListener_ != nullptr)
+      readyListener_->notifyReady();
+  }
+};
+
+} // namespace VCTR::network::physical
+
+#endif // EXVECTRNETWORK_READYNOTIFIER_HPP_
@@ -10,18 +10,26 @@
 
 #include "ExVectrHAL/digital_io.hpp"
 
+#include "ExVectrNetwork/physical/ReadyNotifier.hpp"
+
 namespace VCTR::network::physical {
 
 /**
- * @brief A class implementing an IO interface using topics
+ * @brief A class implementing an IO interface using topics. Notifies the
+ * ready listener when bytes are received.
  */
-class TopicIO : public HAL::DigitalIO {
+class TopicIO : public HAL::DigitalIO, public ReadyNotifier {
+public:
+  /// Number of received bytes that can be buffered. Also the largest single
+  /// write, so a write always fits into an empty receive buffer.
+  static constexpr size_t bufferSize = 1024;
+
 private:
   /// Where the bytes are received
   Core::Callback_Subscriber<const Core::List<uint8_t> &, TopicIO> receiveSubr_;
 
   /// List used to buffer received data.
-  Core::ListBuffer<uint8_t, 1024> receiveBuffer_;
+  Core::ListBuffer<uint8_t, bufferSize> receiveBuffer_;
 
 public:
   TopicIO();
@@ -8,6 +8,8 @@
 #include "ExVectrCore/topic.hpp"
 #include "ExVectrCore/topic_subscribers.hpp"
 
+#include "ExVectrNetwork/PacketPool.hpp"
+#include "ExVectrNetwork/Priority.hpp"
 #include "ExVectrNetwork/network/NetworkI.hpp"
 
 namespace VCTR::network::transport {
@@ -30,15 +32,15 @@ private:
     uint16_t srcPort;
     uint16_t dstAddress;
     uint16_t dstPort;
-    /// @brief The data being sent or received. The creator of this structure is
-    /// responsible for managing the memory.
-    Core::ListArray<uint8_t> data;
+    /// @brief The data being sent or received. Copies share the storage, so
+    /// subscribers can keep it without copying the bytes.
+    PacketBuffer data;
   };
 
   /// @brief A version control for the transport simple. This is added together
   /// with the transport identifier to not conflict with other transport
   /// protocols.
-  static constexpr uint8_t transportSimpleVersion = 3;
+  static constexpr uint8_t transportSimpleVersion = 4;
   static constexpr uint8_t transportSimpleID = 1;
 
   /// @brief The limit of segments that can be stored in the segment buffer.
@@ -47,6 +49,14 @@ private:
   /// @brief The size limit of each segment in bytes.
   static constexpr uint8_t segmentSize = 128;
 
+  /// @brief Size of the CRC-32 behind the data of the last segment.
+  static constexpr size_t checksumSize = 4;
+
+  /// @brief Most segments a transfer can have. Data is limited to UINT16_MAX
+  /// bytes by the info segment.
+  static constexpr size_t maxSegments =
+      (UINT16_MAX + segmentSize - 1) / segmentSize;
+
   VCTR::network::network::NetworkI *netNode_ = nullptr;
 
   /// @brief The port that this transport is using.
@@ -64,11 +74,22 @@ private:
   uint16_t numBytes_ = 0;
   /// @brief The current number of segments received.
   uint16_t curSegment_ = 0;
-  /// @brief The expected checksum of the data being received.
-  uint8_t checksum_ = 0;
+  /// @brief One bit per segment of the current data. Set once the segment is
+  /// placed, so repeated segments are not counted twice.
+  uint8_t receivedSegments_[(maxSegments + 7) / 8] = {};
+  /// @brief The expected CRC-32 of the data being received. Sent with the last
+  /// segment.
+  uint32_t checksum_ = 0;
+  /// @brief CRC-32 of the segments received so far, each shifted to its
+  /// position in the data.
+  uint32_t receivedCrc_ = 0;
 
   /// @brief Buffer containing the final received data.
-  Core::ListArray<uint8_t> receivedData_;
+  PacketBuffer receivedData_;
+  /// @brief Pool the received data is allocated from. Heap if nullptr.
+  PacketPool *reassemblyPool_ = nullptr;
+  /// @brief Larger data is discarded when received.
+  size_t maxDataSize_ = UINT16_MAX;
 
   /// @brief The topic to receive data transmitting from the other end.
   Core::Topic<TransportData> receiveTopic_;
@@ -78,7 +99,7 @@ private:
       transmitTopicSubr_;
 
   Core::HandlerGroup<const VCTR::network::network::NetworkPacketHeader &,
-                     const Core::ListArray<uint8_t> &>
+                     const PacketView &>
       receivePacketHandlers_;
 
 public:
@@ -108,14 +129,37 @@ public:
   void setPort(uint16_t port);
   uint16_t getPort();
 
+  /**
+   * @brief   Sets the pool received data is reassembled in.
+   * @note    The published data keeps its slot until all subscribers drop
+   * it. Give the pool enough slots for the data kept by subscribers.
+   * @param pool The pool to use or nullptr for the heap.
+   * @param maxDataSize Larger data is discarded when received.
+   */
+  void setReassemblyPool(PacketPool *pool, size_t maxDataSize);
+
   /**
    * @brief   Sends the given data to the given address and port.
    * @param data The data to send.
    * @param dstAddress The destination address to send data to.
    * @param dstPort The destination port to send data to.
+   * @param priority Transmit priority of all segments.
    */
   void send(const Core::List<uint8_t> &data, uint16_t dstAddress,
-            uint16_t dstPort);
+            uint16_t dstPort, Priority priority = Priority::NORMAL);
+
+  /**
+   * @brief   Sends the given data to the given address and port. The segments
+   * point into the data, so it is only copied when written to the physical
+   * device.
+   * @param data Pointer to the data to send.
+   * @param size Number of bytes to send.
+   * @param dstAddress The destination address to send data to.
+   * @param dstPort The destination port to send data to.
+   * @param priority Transmit priority of all segments.
+   */
+  void send(const uint8_t *data, size_t size, uint16_t dstAddress,
+            uint16_t dstPort, Priority priority = Priority::NORMAL);
 
   /**
    * @brief   Gets the topic to receive data from the network node. Subscribe to
@@ -132,17 +176,38 @@ public:
   Core::Topic<TransportData> &getTransmitTopic();
 
 private:
+  /**
+   * @brief   Sends the info segment that starts a new transfer.
+   * @param numBytes The number of bytes that will be sent.
+   * @param dstAddress The destination address.
+   * @param dstPort The destination port.
+   * @param priority Transmit priority of the segment.
+   * @returns the network header to send the data segments with.
+   */
+  VCTR::network::network::NetworkPacketHeader
+  sendInfoSegment(uint16_t numBytes, uint16_t dstAddress, uint16_t dstPort,
+                  Priority priority);
+
+  /**
+   * @brief   Appends the CRC-32 of all data to the last segment.
+   * @param chain The last segment.
+   * @param crc The CRC-32 of all data.
+   */
+  void addChecksum(PacketChain &chain, uint32_t crc);
+
   /**
    * @brief   Sends a segment of data to the given address and port. Basically
    * appends the required information to the data and sends it.
-   * @param data The data to send.
-   * @param dstAddress The destination address.
+   * @param header The network header to send the segment with.
+   * @param chain The segment to send. Trailer and network header are pushed
+   * into it.
+   * @param order The position of the segment. 0 is the info segment.
    * @param dstPort The destination port.
-   * @param segmentID The ID of the segment being sent.
+   * @param id The ID of the data being sent.
    */
   void sendSegment(const VCTR::network::network::NetworkPacketHeader &header,
-                   Core::ListArray<uint8_t> &data, uint16_t order,
-                   uint16_t dstPort, uint8_t id);
+                   PacketChain &chain, uint16_t order, uint16_t dstPort,
+                   uint8_t id);
 
   /**
    * @brief   Callback function for receiving data from the network node.
@@ -150,7 +215,51 @@ private:
    */
   void receivePacketCallback(
       const VCTR::network::network::NetworkPacketHeader &header,
-      const Core::ListArray<uint8_t> &payload);
+      const PacketView &payload);
+};
+
+/**
+ * @brief   TransportCallback with its own storage for reassembling received
+ * data. Never allocates.
+ * @tparam MAXDATASIZE Largest data that can be received. Larger data is
+ * discarded.
+ * @tparam NUMBUFFERS Number of buffers. One is needed for reassembly, the rest
+ * is for published data still kept by subscribers.
+ */
+template <size_t MAXDATASIZE, size_t NUMBUFFERS = 2>
+class TransportCallbackStatic : public TransportCallback {
+private:
+  PacketPoolStatic<MAXDATASIZE + PacketBuffer::storageHeaderSize, NUMBUFFERS>
+      pool_;
+
+public:
+  /**
+   * @param port The port to use for this transport.
+   */
+  TransportCallbackStatic(uint16_t port) : TransportCallback(port) {
+    setReassemblyPool(&pool_, MAXDATASIZE);
+  }
+
+  /**
+   * @param port The port to use for this transport.
+   * @param node The network node to use for sending and receiving packets.
+   */
+  TransportCallbackStatic(uint16_t port,
+                          VCTR::network::network::NetworkI &node)
+      : TransportCallback(port, node) {
+    setReassemblyPool(&pool_, MAXDATASIZE);
+  }
+
+  /// @returns the number of bytes used by this transport.
+  static constexpr size_t getMemorySize() {
+    return sizeof(TransportCallbackStatic);
+  }
+
+  /// Prints the memory used by this transport.
+  void printMemoryReport() const {
+    LOG_MSG("TransportCallback: %d bytes. Reassembly: %d x %d bytes.\n",
+            int(getMemorySize()), int(NUMBUFFERS), int(MAXDATASIZE));
+  }
 };
 
 } // namespace VCTR::network::transport
@@ -1,36 +1,59 @@
 #ifndef EXVECTRNETWORK_STRUCTS_TRANSPORTHEADER_HPP_
 #define EXVECTRNETWORK_STRUCTS_TRANSPORTHEADER_HPP_
 
-#include "ExVectrCore/list.hpp"
-#include "ExVectrCore/list_buffer.hpp"
-
 #include "ExVectrNetwork/DataPacket.hpp"
+#include "ExVectrNetwork/PacketLayout.hpp"
 
 namespace VCTR::network::transport {
 
-/// @brief   Network packet structure version. Added to the checksum.
-static constexpr uint8_t networkVersion = 2;
-
 /**
- * @brief   Network packet structure.
- * @note    Raw data structure follows this format: [type, hops, dstAddress,
- * srcAddress, checksum, dataLength, data...] Usually only packet hops,
- * dstAddress, payloadLength and payload are used by the application layer. The
- * rest is handled by the network layer.
+ * @brief   Transport segment header. Appended to the back of every segment.
+ * @note    Raw data structure follows this format: [srcPort, dstPort, order,
+ * id, identifier]. Addresses are taken from the network header.
  */
-class TransportHeader : public PacketHeaderI {
+class TransportHeader : public PacketHeader<TransportHeader> {
+  friend PacketHeader<TransportHeader>;
+
+  /// Byte layout of the header.
+  struct Layout {
+    using SrcPort = layout::Field<uint16_t, 0>;
+    using DstPort = layout::Field<uint16_t, SrcPort::end>;
+    using Order = layout::Field<uint16_t, DstPort::end>;
+    using Id = layout::Field<uint8_t, Order::end>;
+    using Identifier = layout::Field<uint8_t, Id::end>;
+  };
+
 public:
-  uint16_t srcAddress;
-  uint16_t srcPort;
-  uint16_t dstAddress;
-  uint16_t dstPort;
+  static constexpr size_t headerSize = Layout::Identifier::end;
+
+  /// Port of the sender.
+  uint16_t srcPort = 0;
+  /// Port of the receiver.
+  uint16_t dstPort = 0;
+  /// Position of the segment. 0 is the info segment.
+  uint16_t order = 0;
+  /// ID of the data this segment belongs to.
+  uint8_t id = 0;
+  /// Identifies the transport protocol and its version.
+  uint8_t identifier = 0;
 
 protected:
-  void serialize(uint8_t *buffer) const override;
-  bool deserialize(const uint8_t *buffer) override;
-
-public:
-  size_t getHeaderSize() const override;
+  void serialize(uint8_t *buffer) const {
+    Layout::SrcPort::write(buffer, srcPort);
+    Layout::DstPort::write(buffer, dstPort);
+    Layout::Order::write(buffer, order);
+    Layout::Id::write(buffer, id);
+    Layout::Identifier::write(buffer, identifier);
+  }
+
+  bool deserialize(const uint8_t *buffer) {
+    srcPort = Layout::SrcPort::read(buffer);
+    dstPort = Layout::DstPort::read(buffer);
+    order = Layout::Order::read(buffer);
+    id = Layout::Id::read(buffer);
+    identifier = Layout::Identifier::read(buffer);
+    return true;
+  }
 };
 
 } // namespace VCTR::network::transport
@@ -0,0 +1,47 @@
+#include "ExVectrNetwork/Cobs.hpp"
+
+namespace VCTR::network::cobs {
+
+size_t encode(const uint8_t *data, size_t size, uint8_t *buffer) {
+  // Each block starts with a code byte giving the distance to the next zero.
+  size_t codeIndex = 0;
+  size_t index = 1;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < size; i++) {
+    if (data[i] != 0) {
+      buffer[index++] = data[i];
+      code++;
+    }
+    if (data[i] == 0 || code == 0xFF) {
+      buffer[codeIndex] = code;
+      codeIndex = index++;
+      code = 1;
+    }
+  }
+
+  buffer[codeIndex] = code;
+  return index;
+}
+
+size_t decode(const uint8_t *data, size_t size, uint8_t *buffer) {
+  size_t read = 0;
+  size_t written = 0;
+
+  while (read < size) {
+    uint8_t code = data[read++];
+    if (code == delimiter || read + code - 1 > size)
+      return 0;
+
+    for (uint8_t i = 1; i < code; i++)
+      buffer[written++] = data[read++];
+
+    // Blocks end with a zero, except full blocks and the last one.
+    if (code != 0xFF && read < size)
+      buffer[written++] = 0;
+  }
+
+  return written;
+}
+
+} // namespace VCTR::network::cobs
@@ -0,0 +1,115 @@
+#include "ExVectrNetwork/Crc.hpp"
+
+namespace VCTR::network::crc {
+
+namespace {
+
+constexpr uint16_t polynomial = 0x1021;
+constexpr size_t numSlices = 8;
+
+/// CRC-32 polynomial, bit reversed.
+constexpr uint32_t polynomial32 = 0xEDB88320;
+
+struct Tables {
+  uint16_t table[numSlices][256] = {};
+};
+
+/**
+ * Slice 0 is the usual bytewise table. Slice k is the CRC of a byte followed by
+ * k zero bytes, so 8 bytes can be looked up independently and xored together.
+ */
+constexpr Tables makeTables() {
+  Tables tables;
+  for (size_t i = 0; i < 256; i++) {
+    uint16_t crc = uint16_t(i << 8);
+    for (size_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? uint16_t((crc << 1) ^ polynomial)
+                           : uint16_t(crc << 1);
+    tables.table[0][i] = crc;
+  }
+  for (size_t slice = 1; slice < numSlices; slice++) {
+    for (size_t i = 0; i < 256; i++) {
+      auto prev = tables.table[slice - 1][i];
+      tables.table[slice][i] =
+          uint16_t(prev << 8) ^ tables.table[0][prev >> 8];
+    }
+  }
+  return tables;
+}
+
+// Generated at compile time, ends up in flash.
+constexpr Tables tables = makeTables();
+
+inline uint16_t updateByte(uint16_t crc, uint8_t byte) {
+  return uint16_t(crc << 8) ^ tables.table[0][(crc >> 8) ^ byte];
+}
+
+struct Table32 {
+  uint32_t table[256] = {};
+  /// x^(2^n) modulo the polynomial. Used to shift a CRC by n bits.
+  uint32_t powers[32] = {};
+};
+
+/// Multiplies a and b modulo the polynomial. Bit reversed, so 1 is 1 << 31.
+constexpr uint32_t multModP(uint32_t a, uint32_t b) {
+  uint32_t product = 0;
+  for (uint32_t mask = uint32_t(1) << 31; mask != 0; mask >>= 1) {
+    if (a & mask)
+      product ^= b;
+    b = (b & 1) ? (b >> 1) ^ polynomial32 : b >> 1;
+  }
+  return product;
+}
+
+constexpr Table32 makeTable32() {
+  Table32 tables;
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (size_t bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ polynomial32 : crc >> 1;
+    tables.table[i] = crc;
+  }
+  tables.powers[0] = uint32_t(1) << 30; // x^1
+  for (size_t i = 1; i < 32; i++)
+    tables.powers[i] = multModP(tables.powers[i - 1], tables.powers[i - 1]);
+  return tables;
+}
+
+constexpr Table32 tables32 = makeTable32();
+
+} // namespace
+
+uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc) {
+  const auto &t = tables.table;
+
+  while (size >= numSlices) {
+    crc ^= uint16_t(data[0] << 8 | data[1]);
+    crc = t[7][crc >> 8] ^ t[6][crc & 0xFF] ^ t[5][data[2]] ^ t[4][data[3]] ^
+          t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    data += numSlices;
+    size -= numSlices;
+  }
+
+  while (size-- > 0)
+    crc = updateByte(crc, *data++);
+
+  return crc;
+}
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc) {
+  crc = ~crc;
+  while (size-- > 0)
+    crc = (crc >> 8) ^ tables32.table[(crc ^ *data++) & 0xFF];
+  return ~crc;
+}
+
+uint32_t crc32Shift(uint32_t crc, size_t size) {
+  // Multiply by x^(8 * size), one power of two at a time. Starts at x^8.
+  for (size_t n = 3; size != 0 && crc != 0; size >>= 1, n++) {
+    if (size & 1)
+      crc = multModP(tables32.powers[n & 31], crc);
+  }
+  return crc;
+}
+
+} // namespace VCTR::network::crc
@@ -1,3 +1,5 @@
+#include <cstring>
+
 #include "ExVectrCore/list.hpp"
 #include "ExVectrCore/print.hpp"
 #include "ExVectrCore/time_definitions.hpp"
@@ -6,6 +8,8 @@
 
 #include "ExVectrHAL/digital_io.hpp"
 
+#include "ExVectrNetwork/Cobs.hpp"
+#include "ExVectrNetwork/Crc.hpp"
 #include "ExVectrNetwork/datalink/Datalink.hpp"
 
 /**
@@ -14,57 +18,153 @@
  * one node can send at a time. Then the datalink will send the data in frames
  * of the maximum size the physical layer supports and then send a free command
  * to release the physical layer.
+ *
+ * With aggregation, all queued frames are sent in one block/free window. Each
+ * frame is closed with an end command so the receiver can tell them apart.
+ *
+ * With CSMA, a node waits a random number of slots before blocking a free
+ * medium and gives up if it hears another node first. The node that picked
+ * the fewest slots wins. A window interrupted by another node counts as a
+ * collision: the contention window doubles and the frame is sent again.
+ *
+ * Frames longer than dataLinkMaxFrameLength are sent with long data commands
+ * [DATA_LONG, lengthHigh, lengthLow, data...] when using header framing. A
+ * whole jumbo frame then usually goes out with a single command.
  */
 
 namespace VCTR::network::datalink {
 
-Datalink::Datalink(HAL::DigitalIO &physicalLayerDevice,
-                   Core::Scheduler &scheduler)
-    : Task_Periodic("Datalink", 1000 * Core::MILLISECONDS) {
+DatalinkBase::DatalinkBase(HAL::DigitalIO &physicalLayerDevice,
+                           uint8_t *transmitStorage, size_t transmitSize,
+                           uint8_t *receiveStorage, size_t receiveSize,
+                           Core::Scheduler &scheduler)
+    : Task_Periodic("Datalink", 1000 * Core::MILLISECONDS),
+      transmitBuffer_(transmitStorage, transmitSize),
+      receiveBuffer_(receiveStorage, receiveSize) {
   physicalLayer_ = &physicalLayerDevice;
   scheduler.addTask(*this);
 }
 
-bool Datalink::transmitDataframe(const DataPacket &dataframe) {
+Datalink::Datalink(HAL::DigitalIO &physicalLayerDevice,
+                   Core::Scheduler &scheduler)
+    : DatalinkBase(physicalLayerDevice, transmitStorage_, transmitBufferSize,
+                   receiveStorage_, dataLinkBufferSize, scheduler) {}
+
+bool DatalinkBase::transmitDataframe(const DataPacket &dataframe) {
 
   VRBS_MSG("Received %d bytes from topic to send. Pointer %d \n",
            dataframe.payload.size(), this);
 
   auto len = dataframe.payload.size();
-  if (len > dataLinkMaxFrameLength) {
+  if (len > maxFrameLength_) {
     LOG_MSG("Max frame length exceeded. Failure.\n");
     return false; // Max frame length exceeded. Failure.
   }
-  if (transmitBuffer_.size() >= transmitBuffer_.sizeMax()) {
+  auto trailerLen = frameCrc_ ? crcTrailerSize : 0;
+  if (!transmitBuffer_.begin(dataframe.priority, len + trailerLen,
+                             dataframe.timestamp)) {
     LOG_MSG("Buffer overflow. Failure.\n");
     return false; // Buffer overflow case. Failure.
   }
 
-  PhysicalFrame frame;
-  for (size_t i = 0; i < len; i++)
-    frame.data[i] = dataframe.payload[i];
-  frame.length = len;
-  transmitBuffer_.placeBack(frame);
+  transmitBuffer_.append(dataframe.payload.getPtr(), len);
+  if (frameCrc_) { // Queued behind the payload and sent as part of the frame.
+    auto crc = crc::crc16(dataframe.payload.getPtr(), len);
+    const uint8_t trailer[crcTrailerSize] = {uint8_t(crc >> 8), uint8_t(crc)};
+    transmitBuffer_.append(trailer, crcTrailerSize);
+  }
+  transmitBuffer_.commit();
 
   return true;
 }
 
-size_t Datalink::getBufferFreeSpace() const {
-  return transmitBuffer_.sizeMax() - transmitBuffer_.size();
+size_t DatalinkBase::getBufferFreeSpace() const {
+  auto space = transmitBuffer_.freeSpace(Priority::NORMAL);
+  auto trailerLen = frameCrc_ ? crcTrailerSize : 0;
+  return space > trailerLen ? space - trailerLen : 0;
 }
 
-bool Datalink::isChannelBlocked() const { return physicalBlocked_; }
+bool DatalinkBase::isChannelBlocked() const { return physicalBlocked_; }
+
+size_t DatalinkBase::getMaxPacketSize() const {
+  return maxFrameLength_ < getBufferFreeSpace() ? maxFrameLength_
+                                                : getBufferFreeSpace();
+}
 
-size_t Datalink::getMaxPacketSize() const {
-  return dataLinkMaxFrameLength < getBufferFreeSpace() ? dataLinkMaxFrameLength
-                                                       : getBufferFreeSpace();
+void DatalinkBase::setMaxFrameLength(size_t length) {
+  maxFrameLength_ = length < maxJumboFrameLength ? length : maxJumboFrameLength;
+  receiveBuffer_.abort();
+  receiveDiscard_ = false;
 }
 
-void Datalink::setPhysicalReleaseTimeout(int64_t time) {
+void DatalinkBase::setPhysicalReleaseTimeout(int64_t time) {
   physicalReleaseTime_ = time;
+  adaptiveRelease_ = false;
+}
+
+void DatalinkBase::setAdaptiveReleaseTimeout(int64_t minTime, int64_t maxTime,
+                                             uint16_t deviationFactor) {
+  adaptiveRelease_ = true;
+  minReleaseTime_ = minTime;
+  maxReleaseTime_ = maxTime < minTime ? minTime : maxTime;
+  releaseDeviationFactor_ = deviationFactor;
+  gapSampled_ = false;
+  physicalReleaseTime_ = maxReleaseTime_;
+}
+
+int64_t DatalinkBase::getPhysicalReleaseTimeout() const {
+  return physicalReleaseTime_;
+}
+
+void DatalinkBase::setFraming(Framing framing) {
+  framing_ = framing;
+  receiving_ = false;
+  numBytesReceive_ = 0;
+  receiveHeaderSize_ = 0;
+  cobsSize_ = 0;
+  cobsOverflow_ = false;
+}
+
+void DatalinkBase::setAggregation(size_t maxBytes, int64_t maxTime) {
+  aggregateMaxBytes_ = maxBytes;
+  aggregateMaxTime_ = maxTime;
+}
+
+void DatalinkBase::setCsma(int64_t slotTime, uint16_t minWindow,
+                           uint16_t maxWindow) {
+  slotTime_ = slotTime;
+  minWindow_ = minWindow < 1 ? 1 : minWindow;
+  maxWindow_ = maxWindow < minWindow_ ? minWindow_ : maxWindow;
+  contentionWindow_ = minWindow_;
+  backingOff_ = false;
+  setRandomSeed(randomState_ ^ uint32_t(Core::NowNs()));
+}
+
+void DatalinkBase::setRandomSeed(uint32_t seed) {
+  randomState_ = seed != 0 ? seed : 1; // Xorshift never leaves 0.
+}
+
+const DatalinkBase::AccessCounters &DatalinkBase::getAccessCounters() const {
+  return accessCounters_;
+}
+
+void DatalinkBase::resetAccessCounters() {
+  accessCounters_ = AccessCounters();
+}
+
+void DatalinkBase::setTransmitScheduling(TransmitScheduling scheduling) {
+  transmitBuffer_.setScheduling(scheduling);
 }
 
-void Datalink::taskInit() {
+void DatalinkBase::setPriorityWeight(Priority priority, uint16_t weight) {
+  transmitBuffer_.setWeight(priority, weight);
+}
+
+void DatalinkBase::setByteBudget(size_t bytes) {
+  byteBudget_ = bytes < 3 ? 3 : bytes;
+}
+
+void DatalinkBase::taskInit() {
 
   // Lock system for the case that we connect to an already running system.
   transmitting_ = false;
@@ -73,162 +173,585 @@ void Datalink::taskInit() {
       Core::NowNs() - 1 * Core::SECONDS; // Listen for an extra second.
 }
 
-void Datalink::taskThread() {
+void DatalinkBase::taskThread() {
 
   VRBS_MSG("Datalink thread running. Pointer %d. Time: %f\n", this,
            Core::NowS());
 
-  // Read from physical and check status
-  auto readLen = physicalLayer_->readable();
-  if (readLen > 0) {
+  wakeupPending_ = false;
 
-    VRBS_MSG("Reading %d bytes. Receiving is %d\n", readLen, receiving_);
+  // Run receive and transmit until there is nothing left to do or the budget
+  // is used up. A burst of frames is then handled in a single run and a frame
+  // is sent with its block, data and free in one go.
+  size_t budget = byteBudget_;
+  bool progress = true;
+  while (progress && budget > 0) {
+    progress = false;
 
-    if (!receiving_) {
+    while (budget > 0 && physicalLayer_->readable() > 0) {
+      auto read = receiveFromPhysical();
+      if (read == 0)
+        break;
+      budget -= read < budget ? read : budget;
+      progress = true;
+    }
 
-      uint8_t data;
-      physicalLayer_->readByte(data);
+    // Check if timeout was reached for physical access. In this case we can
+    // reset access.
+    auto releaseTime = physicalReleaseTime_;
+    if (collided_ && 2 * slotTime_ < releaseTime)
+      releaseTime = 2 * slotTime_;
+    if (Core::NowNs() - physicalBlockTimestamp_ > releaseTime) {
+      physicalBlockTimestamp_ =
+          Core::END_OF_TIME; // END_OF_TIME to stop this from triggering again.
+      physicalBlocked_ = false;
+      // The free was lost or the sender is gone. A frame cut off by a
+      // collision is sent again, anything else is handed on.
+      if (collided_ && !frameCrc_)
+        receiveBuffer_.abort();
+      else
+        finishFrame();
+      receiveDiscard_ = false;
+      receiving_ = false;
+      receiveHeaderSize_ = 0;
+      collided_ = false;
+      publishFrames();
+    }
+
+    if (budget > 0) {
+      auto written = transmitToPhysical(budget);
+      budget -= written < budget ? written : budget;
+      progress |= written > 0;
+    }
+  }
 
-      switch (PhysicalHeader(data)) {
-      case PhysicalHeader::BLOCK: // Physical is now in use by another node.
-        transmitting_ = false;
-        physicalBlocked_ = true;
-        physicalBlockTimestamp_ = Core::NowNs();
+  // Bytes left behind by the budget would not be announced again. Run again.
+  if (budget == 0 && physicalLayer_->readable() > 0)
+    wakeupPending_ = true;
+}
 
-        VRBS_MSG("Header is block.\n");
+size_t DatalinkBase::transmitToPhysical(size_t budget) {
 
-        break;
+  // If physical is unblocked, then try to gain access if there is data to send.
+  if (physicalBlocked_ || (transmitBuffer_.size() == 0 && !transmitting_))
+    return 0;
 
-      case PhysicalHeader::DATA: // Received data from channel. Block usage.
-        // VRBS_MSG("Header data with %d bytes.\n", buffer[1]);
-        transmitting_ = false;
-        physicalBlocked_ = true;
-        receiving_ = true;
-        physicalBlockTimestamp_ = Core::NowNs();
+  auto writeLen = physicalLayer_->writable();
+  auto commandLen = getCommandOverhead(PhysicalHeader::BLOCK);
+  if (transmitting_ && numBytesTransmit_ == 0 && writeLen >= commandLen) {
 
-        physicalLayer_->readByte(data);
-        numBytesReceive_ = data;
+    popTransmitFrame(); // Frame is sent.
 
-        VRBS_MSG("Header is data with %d bytes.\n", numBytesReceive_);
+    if (canAggregate()) { // Keep the medium for the next frame.
 
-        break;
+      VRBS_MSG("Ending frame, next in same window.\n");
 
-      case PhysicalHeader::FREE: // Channel has been freed up for use. If data
-                                 // was received, then publish it.
-        physicalBlocked_ = false;
-        receiving_ = false;
-
-        if (receiveBuffer_.size() > 0) {
-          VRBS_MSG("Publishing %d bytes. This: %d \n", receiveBuffer_.size(),
-                   this);
-          while (receiveBuffer_.size() > 0) {
-            DataPacket dataframe;
-            for (size_t i = 0; i < receiveBuffer_[0].length; i++)
-              dataframe.payload.append(receiveBuffer_[0].data[i]);
-            receiveBuffer_.removeFront();
-            receiveHandlers_.callHandlers(dataframe);
-          }
-          receiveBuffer_.clear();
-        }
-
-        VRBS_MSG("Header is free.\n");
+      loadTransmitFrame();
+      return writeCommand(PhysicalHeader::END);
+    }
 
-        break;
+    // Free medium if nothing more to write.
+    VRBS_MSG("Freeing medium!\n");
 
-      default:
-        VRBS_MSG("Header unknown.\n");
-        break;
-      }
+    transmitting_ = false;
+    contentionWindow_ = minWindow_; // Got through.
+    return writeCommand(PhysicalHeader::FREE);
+  }
+
+  if (!transmitting_ && writeLen >= commandLen) { // Gain access to medium
+
+    if (!backoffElapsed())
+      return 0;
+
+    windowStart_ = Core::NowNs();
+    windowBytes_ = 0;
+    loadTransmitFrame();
+    transmitting_ = true;
+
+    VRBS_MSG("Ready to send: %d bytes. Blocking medium.\n", numBytesTransmit_);
+
+    return writeCommand(PhysicalHeader::BLOCK);
+  }
+
+  auto command = getDataCommand();
+  auto overhead = getCommandOverhead(command);
+  if (transmitting_ && writeLen > overhead && budget > overhead) {
+
+    size_t sendLen = numBytesTransmit_;
+    auto maxChunk =
+        command == PhysicalHeader::DATA_LONG ? maxLongDataChunk : maxDataChunk;
+    if (sendLen > maxChunk)
+      sendLen = maxChunk;
+    if (sendLen > writeLen - overhead)
+      sendLen = writeLen - overhead;
+    if (sendLen > budget - overhead)
+      sendLen = budget - overhead;
+
+    VRBS_MSG("Sending: %d\n", sendLen);
+
+    auto written = command == PhysicalHeader::DATA_LONG
+                       ? writeLongData(sendLen)
+                       : writeCommand(PhysicalHeader::DATA, sendLen);
+
+    transmitOffset_ += sendLen;
+    numBytesTransmit_ -= sendLen;
+    return written;
+  }
+
+  return 0;
+}
+
+size_t DatalinkBase::getCommandOverhead(PhysicalHeader command) const {
+  // Code byte and delimiter. Chunks are short enough for a single code byte.
+  if (framing_ == Framing::COBS)
+    return 1 + cobs::maxEncodedSize(1 + maxDataChunk) - maxDataChunk;
+  if (command == PhysicalHeader::DATA_LONG)
+    return 3; // Command and 16 bit length.
+  return command == PhysicalHeader::DATA ? 2 : 1; // Command and length.
+}
+
+DatalinkBase::PhysicalHeader DatalinkBase::getDataCommand() const {
+  // Long commands only with jumbo frames, so the default stays compatible.
+  // COBS records need a copy anyway, so these keep short chunks.
+  if (framing_ == Framing::HEADERS && maxFrameLength_ > dataLinkMaxFrameLength)
+    return PhysicalHeader::DATA_LONG;
+  return PhysicalHeader::DATA;
+}
+
+size_t DatalinkBase::writeLongData(size_t size) {
+  uint8_t header[3] = {uint8_t(PhysicalHeader::DATA_LONG), uint8_t(size >> 8),
+                       uint8_t(size)};
+  size_t written = physicalLayer_->writeData(header, sizeof(header));
+
+  // Written in the parts the frame has in the buffer. Usually one.
+  size_t offset = transmitOffset_;
+  while (size > 0) {
+    size_t partLen;
+    auto part = transmitBuffer_.peekTaken(offset, partLen);
+    if (partLen == 0)
+      break;
+    if (partLen > size)
+      partLen = size;
+    written += physicalLayer_->writeData(part, partLen);
+    offset += partLen;
+    size -= partLen;
+  }
+
+  return written;
+}
+
+size_t DatalinkBase::writeCommand(PhysicalHeader command, size_t size) {
+  uint8_t raw[2 + maxDataChunk];
+  size_t rawSize = 0;
+  raw[rawSize++] = uint8_t(command);
+  // The delimiter already gives the length when using COBS.
+  if (command == PhysicalHeader::DATA && framing_ == Framing::HEADERS)
+    raw[rawSize++] = size;
+  rawSize += transmitBuffer_.readTaken(transmitOffset_, raw + rawSize, size);
+
+  if (framing_ == Framing::HEADERS)
+    return physicalLayer_->writeData(raw, rawSize);
+
+  uint8_t encoded[cobs::maxEncodedSize(sizeof(raw)) + 1];
+  auto encodedSize = cobs::encode(raw, rawSize, encoded);
+  encoded[encodedSize++] = cobs::delimiter;
+  return physicalLayer_->writeData(encoded, encodedSize);
+}
+
+void DatalinkBase::loadTransmitFrame() {
+  // The frame stays taken until it is sent, also when sent again.
+  transmitBuffer_.take();
+  numBytesTransmit_ = transmitBuffer_.takenSize();
+  transmitOffset_ = 0;
+  windowBytes_ += numBytesTransmit_;
+}
+
+bool DatalinkBase::canAggregate() {
+  if (aggregateMaxBytes_ == 0 || transmitBuffer_.size() == 0)
+    return false;
+
+  return windowBytes_ + transmitBuffer_.frontSize() <= aggregateMaxBytes_ &&
+         Core::NowNs() - windowStart_ < aggregateMaxTime_;
+}
+
+void DatalinkBase::popTransmitFrame() {
+  transmitBuffer_.release();
+  resends_ = 0;
+}
+
+bool DatalinkBase::backoffElapsed() {
+  if (slotTime_ == 0)
+    return true;
+
+  auto now = Core::NowNs();
+  if (!backingOff_) {
+    backingOff_ = true;
+    backoffEnd_ = now + int64_t(random(contentionWindow_)) * slotTime_;
+  }
+  if (now < backoffEnd_)
+    return false;
+
+  backingOff_ = false;
+  return true;
+}
+
+void DatalinkBase::mediumTaken() {
+
+  // Arrival times differ between nodes. Keeps their backoffs apart even with
+  // the same seed.
+  setRandomSeed(randomState_ ^ uint32_t(Core::NowNs()));
+
+  if (backingOff_) { // Lost the contention. A new backoff starts once free.
+    backingOff_ = false;
+    accessCounters_.deferrals++;
+  }
+
+  if (!transmitting_)
+    return;
+
+  // Another node talked during our window. The receivers drop what was sent
+  // of the frame. Frames ended before are delivered.
+  transmitting_ = false;
+  accessCounters_.collisions++;
+
+  if (slotTime_ != 0) {
+    collided_ = true;
+    contentionWindow_ = contentionWindow_ * 2 < maxWindow_
+                            ? contentionWindow_ * 2
+                            : maxWindow_;
+    if (resends_ < csmaMaxRetries) { // Stays queued for the next window.
+      resends_++;
+      accessCounters_.retries++;
+      return;
+    }
+    VRBS_MSG("Datalink: Frame interrupted too often. Dropped.\n");
+    accessCounters_.dropped++;
+  }
+
+  popTransmitFrame();
+}
+
+uint32_t DatalinkBase::random(uint32_t range) {
+  // Xorshift32. Good enough to spread nodes over slots.
+  randomState_ ^= randomState_ << 13;
+  randomState_ ^= randomState_ >> 17;
+  randomState_ ^= randomState_ << 5;
+  return range > 0 ? randomState_ % range : 0;
+}
+
+size_t DatalinkBase::receiveFromPhysical() {
+
+  VRBS_MSG("Reading. Receiving is %d\n", receiving_);
+
+  if (framing_ == Framing::COBS)
+    return receiveCobs();
+
+  size_t consumed = 0;
+
+  if (!receiving_) {
+
+    // The length of a data command may arrive in a later read.
+    size_t headerLen = 1;
+    do {
+      uint8_t data;
+      if (!physicalLayer_->readByte(data))
+        return consumed;
+      receiveHeader_[receiveHeaderSize_++] = data;
+      consumed++;
+
+      auto command = PhysicalHeader(receiveHeader_[0]);
+      if (command == PhysicalHeader::DATA)
+        headerLen = 2;
+      else if (command == PhysicalHeader::DATA_LONG)
+        headerLen = 3;
+    } while (receiveHeaderSize_ < headerLen);
+    receiveHeaderSize_ = 0;
+
+    auto command = PhysicalHeader(receiveHeader_[0]);
+    if (command == PhysicalHeader::DATA) {
+      numBytesReceive_ = receiveHeader_[1];
+      receiving_ = numBytesReceive_ > 0;
+    } else if (command == PhysicalHeader::DATA_LONG) {
+      numBytesReceive_ = size_t(receiveHeader_[1]) << 8 | receiveHeader_[2];
+      receiving_ = numBytesReceive_ > 0;
     }
+    handleCommand(command);
+  }
 
-    if (receiving_) {
+  if (receiving_) {
 
-      physicalBlockTimestamp_ = Core::NowNs(); // Reset timeout
+    size_t size = numBytesReceive_;
+    auto readLen = physicalLayer_->readable();
+    if (size > readLen)
+      size = readLen;
 
-      uint8_t size = numBytesReceive_;
-      if (size > readLen)
-        size = readLen;
+    // Read in chunks and copy into the open frame. Data without space is
+    // still read to stay in sync with the headers.
+    uint8_t chunk[32];
+    if (size > sizeof(chunk))
+      size = sizeof(chunk);
+    size = physicalLayer_->readData(chunk, size);
 
-      if (size > receiveBuffer_.sizeMax() - receiveBuffer_.size()) {
+    receiveData(chunk, size);
+    numBytesReceive_ -= size;
+    consumed += size;
 
-        LOG_MSG("Datalink: Buffer overflow. Failure.\n");
-      } else {
-        uint8_t buffer[size];
-        physicalLayer_->readData(buffer, size);
+    if (numBytesReceive_ == 0)
+      receiving_ = false;
+  }
 
-        PhysicalFrame frame;
-        for (uint8_t i = 0; i < size; i++)
-          frame.data[i] = buffer[i];
-        frame.length = size;
-        receiveBuffer_.placeBack(frame);
-        numBytesReceive_ -= size;
+  return consumed;
+}
 
-        if (numBytesReceive_ == 0)
-          receiving_ = false;
+size_t DatalinkBase::receiveCobs() {
 
-        VRBS_MSG("Received %d bytes.\n", size);
-      }
+  uint8_t chunk[32];
+  auto size = physicalLayer_->readData(chunk, sizeof(chunk));
+
+  for (size_t i = 0; i < size; i++) {
+
+    if (chunk[i] != cobs::delimiter) {
+      if (cobsSize_ < sizeof(cobsBuffer_))
+        cobsBuffer_[cobsSize_++] = chunk[i];
+      else
+        cobsOverflow_ = true;
+      continue;
+    }
+
+    // A delimiter always ends a record. Whatever went wrong before, the next
+    // record is read correctly.
+    auto decoded = cobsOverflow_ ? 0 : cobs::decode(cobsBuffer_, cobsSize_,
+                                                    cobsBuffer_);
+    if (decoded > 0) {
+      handleCommand(PhysicalHeader(cobsBuffer_[0]));
+      if (PhysicalHeader(cobsBuffer_[0]) == PhysicalHeader::DATA)
+        receiveData(cobsBuffer_ + 1, decoded - 1);
+    } else if (cobsSize_ > 0) {
+      VRBS_MSG("Datalink: Invalid record dropped.\n");
     }
+    cobsSize_ = 0;
+    cobsOverflow_ = false;
   }
 
-  // Check if timeout was reached for physical access. In this case we can reset
-  // access.
-  if (Core::NowNs() - physicalBlockTimestamp_ > physicalReleaseTime_) {
-    physicalBlockTimestamp_ =
-        Core::END_OF_TIME; // END_OF_TIME to stop this from triggering again.
+  return size;
+}
+
+void DatalinkBase::handleCommand(PhysicalHeader command) {
+
+  switch (command) {
+  case PhysicalHeader::BLOCK: // Physical is now in use by another node.
+    // A frame still open in a window that was not freed was cut off by this
+    // block. Its sender sends it again whole. A CRC tells if it is complete.
+    if (physicalBlocked_ && !frameCrc_)
+      receiveBuffer_.abort();
+    else
+      finishFrame(); // Data after this belongs to a new frame.
+    receiveDiscard_ = false;
+    collided_ = false; // A new window. Set again if it interrupted ours.
+    mediumTaken();
+    physicalBlocked_ = true;
+    physicalBlockTimestamp_ = lastReceiveTime_ = Core::NowNs();
+    measuringWindow_ = adaptiveRelease_;
+    windowMaxGap_ = 0;
+
+    VRBS_MSG("Header is block.\n");
+
+    break;
+
+  case PhysicalHeader::DATA: // Received data from channel. Block usage.
+  case PhysicalHeader::DATA_LONG:
+    mediumTaken();
+    physicalBlocked_ = true;
+    noteReceive();
+
+    VRBS_MSG("Header is data.\n");
+
+    // All data between block and free is one frame. It may be split over
+    // multiple data headers and arrive over multiple reads. A dropped frame
+    // stays dropped until it ends.
+    if (!receiveBuffer_.isOpen() && !receiveDiscard_) {
+      receiveCrc_ = crc::crc16Init;
+      if (!receiveBuffer_.begin()) {
+        LOG_MSG("Datalink: Buffer overflow. Failure.\n");
+        receiveCounters_.overflows++;
+        receiveDiscard_ = true;
+      }
+    }
+
+    break;
+
+  case PhysicalHeader::END: // Frame is complete, more follow in this window.
+    noteReceive();
+    finishFrame();
+    receiveDiscard_ = false;
+
+    VRBS_MSG("Header is end.\n");
+
+    break;
+
+  case PhysicalHeader::FREE: // Channel has been freed up for use. If data
+                             // was received, then publish it.
     physicalBlocked_ = false;
+    collided_ = false;
+    receiving_ = false;
+    noteReceive();
+    if (measuringWindow_)
+      updateReleaseTime(windowMaxGap_);
+    measuringWindow_ = false;
+    finishFrame();
+    receiveDiscard_ = false;
+    publishFrames();
+
+    VRBS_MSG("Header is free.\n");
+
+    break;
+
+  default:
+    VRBS_MSG("Header unknown.\n");
+    break;
   }
+}
 
-  // If physical is unblocked, then try to gain access if there is data to send.
-  if (!physicalBlocked_ && (transmitBuffer_.size() > 0 || transmitting_)) {
+void DatalinkBase::noteReceive() {
+  auto now = Core::NowNs();
+  // Still measured after a timeout. If the window goes on, the timeout was
+  // too short and the long gap raises it.
+  if (measuringWindow_ && now - lastReceiveTime_ > windowMaxGap_)
+    windowMaxGap_ = now - lastReceiveTime_;
+  physicalBlockTimestamp_ = lastReceiveTime_ = now;
+}
+
+void DatalinkBase::updateReleaseTime(int64_t gap) {
+  // Smoothed like a TCP retransmission timeout.
+  if (!gapSampled_) {
+    gapMean_ = gap;
+    gapDeviation_ = gap / 2;
+    gapSampled_ = true;
+  } else {
+    auto error = gap - gapMean_;
+    gapMean_ += error / 8;
+    gapDeviation_ += ((error < 0 ? -error : error) - gapDeviation_) / 4;
+  }
+
+  // A steady link has no deviation. Keep some margin for scheduling jitter.
+  auto margin = releaseDeviationFactor_ * gapDeviation_;
+  if (margin < gapMean_ / 2)
+    margin = gapMean_ / 2;
+  auto time = gapMean_ + margin;
+  if (time < minReleaseTime_)
+    time = minReleaseTime_;
+  if (time > maxReleaseTime_)
+    time = maxReleaseTime_;
+  physicalReleaseTime_ = time;
 
-    auto writeLen = physicalLayer_->writable();
-    if (transmitting_ && numBytesTransmit_ == 0 &&
-        writeLen > 0) { // Free medium if nothing more to write.
+  VRBS_MSG("Datalink: Release timeout now %d us.\n",
+           int(physicalReleaseTime_ / Core::MICROSECONDS));
+}
 
-      VRBS_MSG("Freeing medium!\n");
+void DatalinkBase::receiveData(const uint8_t *data, size_t size) {
 
-      transmitting_ = false;
-      physicalLayer_->writeByte(uint8_t(PhysicalHeader::FREE));
-    } else if (!transmitting_ && writeLen > 0) { // Gain access to medium
+  noteReceive(); // Reset timeout
 
-      numBytesTransmit_ = transmitBuffer_[0].length;
-      transmitBuffer_.removeFront();
-      transmitting_ = true;
+  if (!receiveBuffer_.isOpen())
+    return; // Frame was already dropped.
 
-      VRBS_MSG("Ready to send: %d bytes. Blocking medium.\n",
-               numBytesTransmit_);
+  auto maxLength = maxFrameLength_ + (frameCrc_ ? crcTrailerSize : 0);
+  if (receiveBuffer_.getOpenSize() + size > maxLength) {
+    VRBS_MSG("Datalink: Received frame too long. Dropped.\n");
+    receiveCounters_.lengthErrors++;
+    receiveBuffer_.abort();
+    receiveDiscard_ = true;
+    return;
+  }
 
-      physicalLayer_->writeByte(uint8_t(PhysicalHeader::BLOCK));
-    } else if (transmitting_ && writeLen > 2) {
+  if (receiveBuffer_.append(data, size) != size) {
+    VRBS_MSG("Datalink: No space for received data. Dropped.\n");
+    receiveCounters_.overflows++;
+    receiveBuffer_.abort();
+    receiveDiscard_ = true;
+    return;
+  }
 
-      size_t sendLen = numBytesTransmit_;
-      if (sendLen > 250)
-        sendLen = 250;
-      if (sendLen > writeLen - 2)
-        sendLen = writeLen - 2;
+  // Checked while receiving, so the end of the frame costs nothing.
+  if (frameCrc_)
+    receiveCrc_ = crc::crc16(data, size, receiveCrc_);
 
-      uint8_t buffer[sendLen + 2];
-      buffer[0] = uint8_t(PhysicalHeader::DATA);
-      buffer[1] = sendLen;
-      for (uint8_t i = 0; i < sendLen; i++)
-        buffer[i + 2] = transmitBuffer_[0].data[i];
-      transmitBuffer_.removeFront();
+  VRBS_MSG("Received %d bytes.\n", size);
+}
 
-      VRBS_MSG("Sending: %d\n", sendLen);
+void DatalinkBase::finishFrame() {
+  if (!receiveBuffer_.isOpen())
+    return;
 
-      physicalLayer_->writeData(buffer, sendLen + 2);
+  if (frameCrc_) {
+    if (receiveBuffer_.getOpenSize() < crcTrailerSize) {
+      VRBS_MSG("Datalink: Received frame too short. Dropped.\n");
+      receiveCounters_.lengthErrors++;
+      receiveBuffer_.abort();
+      return;
+    }
+    // The CRC over the data and its CRC is 0 if intact.
+    if (receiveCrc_ != 0) {
+      VRBS_MSG("Datalink: Received frame CRC failed. Dropped.\n");
+      receiveCounters_.crcErrors++;
+      receiveBuffer_.abort();
+      return;
+    }
+    receiveBuffer_.shrink(crcTrailerSize);
+  }
+
+  receiveBuffer_.commit();
+}
 
-      numBytesTransmit_ -= sendLen;
+void DatalinkBase::publishFrames() {
+  if (receiveBuffer_.numFrames() == 0)
+    return;
+
+  VRBS_MSG("Publishing %d frames. This: %d \n", receiveBuffer_.numFrames(),
+           this);
+  while (receiveBuffer_.numFrames() > 0) {
+    DataPacket dataframe;
+    dataframe.payload.setPool(packetPool_);
+    bool stored = dataframe.payload.setSize(receiveBuffer_.frontSize());
+    if (stored)
+      receiveBuffer_.copyFront(dataframe.payload.getPtr());
+    receiveBuffer_.pop();
+    if (stored) {
+      receiveCounters_.received++;
+      receiveHandlers_.callHandlers(dataframe);
+    } else {
+      LOG_MSG("Datalink: No storage for frame. Dropped.\n");
+      receiveCounters_.noStorage++;
     }
   }
 }
 
-void Datalink::taskCheck() {
+void DatalinkBase::setFrameCrc(bool enable) {
+  frameCrc_ = enable;
+  receiveBuffer_.abort();
+  receiveDiscard_ = false;
+}
+
+const ReceiveCounters &DatalinkBase::getReceiveCounters() const {
+  return receiveCounters_;
+}
+
+void DatalinkBase::resetReceiveCounters() {
+  receiveCounters_ = ReceiveCounters();
+}
+
+void DatalinkBase::notifyReady() { wakeupPending_ = true; }
+
+void DatalinkBase::listenTo(physical::ReadyNotifier &notifier) {
+  notifier.setReadyListener(this);
+  pollPhysical_ = false;
+}
+
+void DatalinkBase::taskCheck() {
 
-  if (transmitBuffer_.size() > 0 ||
+  if (wakeupPending_ || transmitBuffer_.size() > 0 ||
       (transmitting_ && physicalLayer_->writable() > 0) ||
-      physicalLayer_->readable() > 0) {
+      (pollPhysical_ && physicalLayer_->readable() > 0)) {
     setRelease(Core::NowNs());
   }
 }
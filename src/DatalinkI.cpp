@@ -15,6 +15,23 @@ void DatalinkI::addReceiveHandler(
   receiveHandlers_.addHandler(handler);
 }
 
+bool DatalinkI::transmitDataframe(const PacketChain &dataframe) {
+  DataPacket packet;
+  packet.payload.setPool(packetPool_);
+  if (!packet.payload.setSize(dataframe.size()))
+    return false;
+  dataframe.copyTo(packet.payload.getPtr());
+  packet.timestamp = dataframe.timestamp;
+  packet.priority = dataframe.priority;
+  return transmitDataframe(packet);
+}
+
+void DatalinkI::setTransmitScheduling(TransmitScheduling scheduling) {}
+
+void DatalinkI::setPriorityWeight(Priority priority, uint16_t weight) {}
+
 void DatalinkI::clearReceiveHandlers() { receiveHandlers_.clearHandlers(); }
 
+void DatalinkI::setPacketPool(PacketPool *pool) { packetPool_ = pool; }
+
 } // namespace VCTR::network::datalink
\ No newline at end of file
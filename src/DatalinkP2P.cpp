@@ -0,0 +1,46 @@
+#include "ExVectrCore/time_definitions.hpp"
+
+#include "ExVectrHAL/digital_io.hpp"
+
+#include "ExVectrNetwork/datalink/DatalinkP2P.hpp"
+
+/**
+ * Frames are sent as [sync, lengthHigh, lengthLow, check, data..., crcHigh,
+ * crcLow], see DatalinkStream. Both directions have their own wire, so frames
+ * are written as soon as they are queued while received frames are read at
+ * the same time.
+ */
+
+namespace VCTR::network::datalink {
+
+DatalinkP2P::DatalinkP2P(HAL::DigitalIO &physicalLayerDevice,
+                         size_t maxFrameLength, Core::Scheduler &scheduler)
+    : DatalinkStream("DatalinkP2P", physicalLayerDevice, 0, transmitStorage_,
+                     defaultBufferSize, maxFrameLength, defaultByteBudget,
+                     scheduler) {}
+
+bool DatalinkP2P::isChannelBlocked() const { return false; }
+
+bool DatalinkP2P::nextFrame() {
+  if (transmitBuffer_.size() == 0)
+    return false;
+
+  sendQueuedFrame(nullptr);
+  return true;
+}
+
+void DatalinkP2P::frameReceived(const uint8_t *fields, DataPacket &frame) {
+  receiveCounters_.received++;
+  receiveHandlers_.callHandlers(frame);
+}
+
+void DatalinkP2P::taskCheck() {
+
+  if (wakeupPending_ ||
+      (transmitBuffer_.size() > 0 && physicalLayer_->writable() > 0) ||
+      (pollPhysical_ && physicalLayer_->readable() > 0)) {
+    setRelease(Core::NowNs());
+  }
+}
+
+} // namespace VCTR::network::datalink
@@ -0,0 +1,356 @@
+#include <cstring>
+
+#include "ExVectrCore/print.hpp"
+#include "ExVectrCore/time_definitions.hpp"
+
+#include "ExVectrHAL/digital_io.hpp"
+
+#include "ExVectrNetwork/Crc.hpp"
+#include "ExVectrNetwork/datalink/DatalinkStream.hpp"
+
+/**
+ * Each frame is sent as [sync, fields..., lengthHigh, lengthLow, check,
+ * data..., crcHigh, crcLow]. The fields are added by the derived class. The
+ * check byte is the low byte of the CRC-16 over the fields and the length, so
+ * a corrupt header is caught before any data is read. The CRC-16 behind the
+ * frame covers everything after the sync byte.
+ *
+ * Received data is read straight into the packet handed on. After a wrong
+ * check byte the header bytes are searched for the next sync byte. After a
+ * wrong length or CRC the receiver searches for the next sync byte.
+ */
+
+namespace VCTR::network::datalink {
+
+DatalinkStream::DatalinkStream(const char *name,
+                               HAL::DigitalIO &physicalLayerDevice,
+                               size_t headerFields, uint8_t *transmitStorage,
+                               size_t transmitSize, size_t maxFrameLength,
+                               size_t byteBudget, Core::Scheduler &scheduler)
+    : Task_Periodic(name, 1000 * Core::MILLISECONDS),
+      transmitBuffer_(transmitStorage, transmitSize) {
+  physicalLayer_ = &physicalLayerDevice;
+  headerFields_ =
+      headerFields > maxHeaderFields ? maxHeaderFields : headerFields;
+  maxFrameLength_ = maxFrameLength > TransmitQueue::maxFrameSize
+                        ? TransmitQueue::maxFrameSize
+                        : maxFrameLength;
+  setByteBudget(byteBudget);
+  scheduler.addTask(*this);
+}
+
+bool DatalinkStream::transmitDataframe(const DataPacket &dataframe) {
+
+  auto len = dataframe.payload.size();
+  if (len == 0 || len > maxFrameLength_) {
+    LOG_MSG("Datalink: Bad frame length %d. Failure.\n", len);
+    return false;
+  }
+  if (!transmitBuffer_.push(dataframe)) {
+    LOG_MSG("Datalink: Buffer overflow. Failure.\n");
+    return false;
+  }
+
+  return true;
+}
+
+size_t DatalinkStream::getMaxPacketSize() const {
+  auto space = transmitBuffer_.freeSpace(Priority::NORMAL);
+  return maxFrameLength_ < space ? maxFrameLength_ : space;
+}
+
+void DatalinkStream::setByteBudget(size_t bytes) {
+  byteBudget_ = bytes < 1 ? 1 : bytes;
+}
+
+void DatalinkStream::setTransmitStorage(uint8_t *storage, size_t size) {
+  transmitBuffer_.setStorage(storage, size);
+  if (transmitQueued_) // The frame being sent is gone.
+    transmitting_ = false;
+}
+
+void DatalinkStream::setTransmitScheduling(TransmitScheduling scheduling) {
+  transmitBuffer_.setScheduling(scheduling);
+}
+
+void DatalinkStream::setPriorityWeight(Priority priority, uint16_t weight) {
+  transmitBuffer_.setWeight(priority, weight);
+}
+
+const ReceiveCounters &DatalinkStream::getReceiveCounters() const {
+  return receiveCounters_;
+}
+
+void DatalinkStream::resetReceiveCounters() {
+  receiveCounters_ = ReceiveCounters();
+}
+
+void DatalinkStream::notifyReady() { wakeupPending_ = true; }
+
+void DatalinkStream::listenTo(physical::ReadyNotifier &notifier) {
+  notifier.setReadyListener(this);
+  pollPhysical_ = false;
+}
+
+void DatalinkStream::sendQueuedFrame(const uint8_t *fields) {
+  transmitQueued_ = true;
+  transmitData_ = nullptr;
+  transmitBuffer_.take();
+  transmitLength_ = transmitBuffer_.takenSize();
+  loadTransmitFrame(fields);
+}
+
+void DatalinkStream::sendFrame(const uint8_t *fields, const uint8_t *data,
+                               size_t length) {
+  transmitQueued_ = false;
+  transmitData_ = data;
+  transmitLength_ = length;
+  loadTransmitFrame(fields);
+}
+
+bool DatalinkStream::isTransmitting() const { return transmitting_; }
+
+bool DatalinkStream::isReceiving() const {
+  return receiveState_ != ReceiveState::SYNC;
+}
+
+void DatalinkStream::abortReceive() {
+  receiveState_ = ReceiveState::SYNC;
+  receiveFrame_ = DataPacket();
+}
+
+void DatalinkStream::taskInit() { abortReceive(); }
+
+void DatalinkStream::taskThread() {
+
+  wakeupPending_ = false;
+
+  // Both directions share the budget in each pass.
+  size_t budget = byteBudget_;
+  bool progress = true;
+  while (progress && budget > 0) {
+    auto read = receiveFromPhysical(budget);
+    budget -= read;
+    updateAccess();
+    auto written = transmitToPhysical(budget);
+    budget -= written;
+    progress = read > 0 || written > 0;
+  }
+
+  // Bytes left behind by the budget would not be announced again. Run again.
+  if (budget == 0 && physicalLayer_->readable() > 0)
+    wakeupPending_ = true;
+}
+
+void DatalinkStream::loadTransmitFrame(const uint8_t *fields) {
+
+  auto headerSize = frameHeaderBaseSize + headerFields_;
+  transmitHeader_[0] = syncByte;
+  if (headerFields_ > 0)
+    memcpy(transmitHeader_ + 1, fields, headerFields_);
+  transmitHeader_[headerFields_ + 1] = transmitLength_ >> 8;
+  transmitHeader_[headerFields_ + 2] = transmitLength_;
+  transmitHeader_[headerSize - 1] =
+      crc::crc16(transmitHeader_ + 1, headerSize - 2);
+
+  auto crc = crc::crc16(transmitHeader_ + 1, headerSize - 1);
+  if (transmitQueued_) { // In the parts the frame has in the buffer.
+    size_t offset = 0;
+    while (offset < transmitLength_) {
+      size_t partLen;
+      auto part = transmitBuffer_.peekTaken(offset, partLen);
+      crc = crc::crc16(part, partLen, crc);
+      offset += partLen;
+    }
+  } else {
+    crc = crc::crc16(transmitData_, transmitLength_, crc);
+  }
+  transmitTrailer_[0] = crc >> 8;
+  transmitTrailer_[1] = crc;
+
+  transmitOffset_ = 0;
+  transmitting_ = true;
+}
+
+size_t DatalinkStream::transmitToPhysical(size_t budget) {
+
+  if (!transmitting_ && !nextFrame())
+    return 0;
+
+  auto headerSize = frameHeaderBaseSize + headerFields_;
+  auto dataEnd = headerSize + transmitLength_;
+
+  const uint8_t *part;
+  size_t partLen;
+  if (transmitOffset_ < headerSize) {
+    part = transmitHeader_ + transmitOffset_;
+    partLen = headerSize - transmitOffset_;
+  } else if (transmitOffset_ < dataEnd && transmitQueued_) {
+    part = transmitBuffer_.peekTaken(transmitOffset_ - headerSize, partLen);
+  } else if (transmitOffset_ < dataEnd) {
+    part = transmitData_ + transmitOffset_ - headerSize;
+    partLen = dataEnd - transmitOffset_;
+  } else {
+    part = transmitTrailer_ + transmitOffset_ - dataEnd;
+    partLen = dataEnd + frameTrailerSize - transmitOffset_;
+  }
+
+  auto writeLen = physicalLayer_->writable();
+  if (partLen > writeLen)
+    partLen = writeLen;
+  if (partLen > budget)
+    partLen = budget;
+  if (partLen == 0)
+    return 0;
+
+  auto written = physicalLayer_->writeData(part, partLen);
+  transmitOffset_ += written;
+
+  if (transmitOffset_ == dataEnd + frameTrailerSize) {
+    transmitting_ = false;
+    if (transmitQueued_)
+      transmitBuffer_.release();
+    frameSent();
+  }
+
+  return written;
+}
+
+size_t DatalinkStream::receiveFromPhysical(size_t budget) {
+
+  size_t consumed = 0;
+  while (consumed < budget) {
+
+    size_t size = physicalLayer_->readable();
+    if (size > budget - consumed)
+      size = budget - consumed;
+    if (size == 0)
+      break;
+    lastActivity_ = Core::NowNs();
+
+    if (receiveState_ == ReceiveState::DATA && !receiveDiscard_) {
+      // Read the data straight into the frame.
+      if (size > receiveLength_ - receiveOffset_)
+        size = receiveLength_ - receiveOffset_;
+      auto data = receiveFrame_.payload.getPtr() + receiveOffset_;
+      size = physicalLayer_->readData(data, size);
+      if (size == 0)
+        break;
+      receiveCrc_ = crc::crc16(data, size, receiveCrc_);
+      receiveOffset_ += size;
+      if (receiveOffset_ == receiveLength_) {
+        receiveState_ = ReceiveState::TRAILER;
+        receiveOffset_ = 0;
+      }
+      consumed += size;
+      continue;
+    }
+
+    uint8_t chunk[32];
+    if (size > sizeof(chunk))
+      size = sizeof(chunk);
+    size = physicalLayer_->readData(chunk, size);
+    if (size == 0)
+      break;
+    parse(chunk, size);
+    consumed += size;
+  }
+
+  return consumed;
+}
+
+void DatalinkStream::parse(const uint8_t *data, size_t size) {
+
+  for (size_t i = 0; i < size; i++) {
+
+    switch (receiveState_) {
+    case ReceiveState::SYNC:
+      if (data[i] == syncByte) {
+        receiveState_ = ReceiveState::HEADER;
+        receiveOffset_ = 0;
+      }
+      break;
+
+    case ReceiveState::HEADER:
+      receiveHeader_[receiveOffset_] = data[i];
+      if (++receiveOffset_ == frameHeaderBaseSize - 1 + headerFields_)
+        beginFrame();
+      break;
+
+    case ReceiveState::DATA: {
+      auto length = receiveLength_ - receiveOffset_;
+      if (length > size - i)
+        length = size - i;
+      if (!receiveDiscard_)
+        memcpy(receiveFrame_.payload.getPtr() + receiveOffset_, data + i,
+               length);
+      receiveCrc_ = crc::crc16(data + i, length, receiveCrc_);
+      receiveOffset_ += length;
+      i += length - 1;
+      if (receiveOffset_ == receiveLength_) {
+        receiveState_ = ReceiveState::TRAILER;
+        receiveOffset_ = 0;
+      }
+      break;
+    }
+
+    case ReceiveState::TRAILER:
+      receiveCrc_ = crc::crc16(data + i, 1, receiveCrc_);
+      if (++receiveOffset_ == frameTrailerSize)
+        finishFrame();
+      break;
+    }
+  }
+}
+
+void DatalinkStream::beginFrame() {
+
+  receiveState_ = ReceiveState::SYNC;
+
+  auto headerLen = frameHeaderBaseSize - 1 + headerFields_;
+  if (receiveHeader_[headerLen - 1] !=
+      uint8_t(crc::crc16(receiveHeader_, headerLen - 1))) {
+    // Not a frame start, or a corrupt header. The real sync byte may follow.
+    uint8_t header[sizeof(receiveHeader_)];
+    memcpy(header, receiveHeader_, headerLen);
+    parse(header, headerLen);
+    return;
+  }
+
+  receiveLength_ = size_t(receiveHeader_[headerFields_]) << 8 |
+                   receiveHeader_[headerFields_ + 1];
+  if (receiveLength_ == 0 || receiveLength_ > maxFrameLength_ ||
+      !checkHeader(receiveHeader_, receiveLength_)) {
+    VRBS_MSG("Datalink: Bad frame header. Dropped.\n");
+    receiveCounters_.lengthErrors++;
+    return;
+  }
+
+  receiveCrc_ = crc::crc16(receiveHeader_, headerLen);
+  receiveFrame_ = DataPacket();
+  receiveFrame_.payload.setPool(packetPool_);
+  receiveDiscard_ = !receiveFrame_.payload.setSize(receiveLength_);
+  receiveState_ = ReceiveState::DATA;
+  receiveOffset_ = 0;
+}
+
+void DatalinkStream::finishFrame() {
+
+  receiveState_ = ReceiveState::SYNC;
+
+  // The CRC over the header, data and its CRC is 0 if intact.
+  if (receiveCrc_ != 0) {
+    VRBS_MSG("Datalink: Received frame CRC failed. Dropped.\n");
+    receiveCounters_.crcErrors++;
+  } else if (receiveDiscard_) {
+    LOG_MSG("Datalink: No storage for frame. Dropped.\n");
+    receiveCounters_.noStorage++;
+  } else {
+    receiveFrame_.timestamp = Core::NowNs();
+    frameReceived(receiveHeader_, receiveFrame_);
+  }
+
+  receiveFrame_ = DataPacket();
+}
+
+} // namespace VCTR::network::datalink
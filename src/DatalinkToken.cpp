@@ -0,0 +1,209 @@
+#include "ExVectrCore/print.hpp"
+#include "ExVectrCore/time_definitions.hpp"
+
+#include "ExVectrHAL/digital_io.hpp"
+
+#include "ExVectrNetwork/datalink/DatalinkToken.hpp"
+
+/**
+ * Each frame is sent as [sync, type, srcStation, lengthHigh, lengthLow, check,
+ * data..., crcHigh, crcLow], see DatalinkStream. A token frame has a single
+ * data byte: the station it is passed to.
+ *
+ * The token goes around the stations in order of their numbers. The holder
+ * sends its queued frames until the hold time is used up and then passes the
+ * token to the next station. If that station is not heard from within the pass
+ * timeout, it is skipped. If the bus is idle for the loss timeout, the token is
+ * lost and recreated. Station n waits n pass timeouts longer than station 0,
+ * so the first station to notice creates the token and the others hear it
+ * before their own timeout ends. A station holding the token that hears a
+ * lower station send gives up its token, so a duplicate token disappears.
+ * A partial frame is dropped after a silence longer than the pass timeout, so
+ * a station dying mid-frame does not take the next frame with it.
+ */
+
+namespace VCTR::network::datalink {
+
+DatalinkToken::DatalinkToken(HAL::DigitalIO &physicalLayerDevice,
+                             uint8_t station, uint8_t numStations,
+                             size_t maxFrameLength, Core::Scheduler &scheduler)
+    : DatalinkStream("DatalinkToken", physicalLayerDevice, 2,
+                     transmitStorage_, defaultBufferSize, maxFrameLength,
+                     defaultByteBudget, scheduler) {
+  numStations_ = numStations < 1 ? 1 : numStations;
+  station_ = station < numStations_ ? station : numStations_ - 1;
+  successor_ = nextStation(station_);
+}
+
+bool DatalinkToken::isChannelBlocked() const { return !holdingToken_; }
+
+void DatalinkToken::setTokenHoldTime(int64_t time) { tokenHoldTime_ = time; }
+
+void DatalinkToken::setTokenTimeouts(int64_t passTimeout,
+                                     int64_t lossTimeout) {
+  passTimeout_ = passTimeout;
+  lossTimeout_ = lossTimeout;
+}
+
+bool DatalinkToken::hasToken() const { return holdingToken_; }
+
+const DatalinkToken::TokenCounters &DatalinkToken::getTokenCounters() const {
+  return tokenCounters_;
+}
+
+void DatalinkToken::resetCounters() {
+  tokenCounters_ = TokenCounters();
+  resetReceiveCounters();
+}
+
+void DatalinkToken::taskInit() {
+  // Listen first. Station 0 creates the token if nobody has it.
+  DatalinkStream::taskInit();
+  holdingToken_ = awaitingSuccessor_ = false;
+  lastActivity_ = Core::NowNs();
+}
+
+void DatalinkToken::updateAccess() {
+
+  auto now = Core::NowNs();
+
+  // Frames are sent without pauses. Nothing waiting means nothing arrived
+  // since the last read, so after a silence the sender of a partial frame is
+  // gone. Waiting bytes may have arrived at any time while this ran late, so
+  // they never cut off a frame.
+  if (isReceiving() && physicalLayer_->readable() == 0 &&
+      now - lastActivity_ > passTimeout_) {
+    VRBS_MSG("DatalinkToken: Frame cut off. Dropped.\n");
+    receiveCounters_.lengthErrors++;
+    abortReceive();
+  }
+
+  // Only a silent bus means the successor is gone. If something else was
+  // heard, the token is in use and taking it back would duplicate it.
+  if (awaitingSuccessor_ && now - passTime_ > passTimeout_ &&
+      lastActivity_ <= passTime_) {
+    // Take the token back and pass it to the one after.
+    VRBS_MSG("DatalinkToken: Station %d did not answer.\n", successor_);
+    tokenCounters_.skipped++;
+    awaitingSuccessor_ = false;
+    successor_ = nextStation(successor_);
+    holdingToken_ = true;
+    // Already had its turn. Only keeps it if it is the last station left.
+    holdStart_ = successor_ == station_ ? now : now - tokenHoldTime_;
+  } else if (awaitingSuccessor_ && now - passTime_ > passTimeout_) {
+    awaitingSuccessor_ = false; // Loss timeout covers the rest.
+  }
+
+  if (!holdingToken_ && !awaitingSuccessor_ && !isTransmitting() &&
+      now - lastActivity_ > lossTimeout_ + station_ * passTimeout_) {
+    VRBS_MSG("DatalinkToken: Token lost. Creating new one.\n");
+    tokenCounters_.regenerated++;
+    holdingToken_ = true;
+    holdStart_ = now;
+    successor_ = nextStation(station_);
+  }
+}
+
+bool DatalinkToken::nextFrame() {
+
+  if (!holdingToken_)
+    return false;
+
+  auto now = Core::NowNs();
+  if (successor_ == station_) { // Nobody else answered.
+    if (numStations_ == 1)
+      holdStart_ = now; // Keeps the token for good.
+    else if (now - holdStart_ > lossTimeout_)
+      successor_ = nextStation(station_); // Look for the others again.
+    if (successor_ == station_ && transmitBuffer_.size() == 0)
+      return false;
+  }
+
+  // Alone on the bus, the token is kept until looking for the others again.
+  auto holdTime = successor_ == station_ ? lossTimeout_ : tokenHoldTime_;
+  if (transmitBuffer_.size() > 0 && now - holdStart_ < holdTime) {
+    const uint8_t fields[] = {uint8_t(FrameType::DATA), station_};
+    sendingToken_ = false;
+    sendQueuedFrame(fields);
+  } else {
+    const uint8_t fields[] = {uint8_t(FrameType::TOKEN), station_};
+    transmitToken_ = successor_;
+    holdingToken_ = false;
+    sendingToken_ = true;
+    sendFrame(fields, &transmitToken_, 1);
+  }
+
+  return true;
+}
+
+void DatalinkToken::frameSent() {
+  if (sendingToken_) { // Successor must now be heard before the pass timeout.
+    tokenCounters_.passed++;
+    awaitingSuccessor_ = true;
+    passTime_ = Core::NowNs();
+  }
+}
+
+bool DatalinkToken::checkHeader(const uint8_t *fields, size_t length) {
+
+  auto type = FrameType(fields[0]);
+  auto src = fields[1];
+  bool valid = src < numStations_ && src != station_;
+  if (type == FrameType::TOKEN)
+    valid &= length == 1;
+  else
+    valid &= type == FrameType::DATA;
+  if (!valid)
+    return false;
+
+  // Checked on the header, so a long first frame does not look like silence.
+  // Another station sending means the token is in use elsewhere.
+  awaitingSuccessor_ = false;
+  return true;
+}
+
+void DatalinkToken::frameReceived(const uint8_t *fields, DataPacket &frame) {
+
+  auto src = fields[1];
+  if (holdingToken_ && src < station_) {
+    VRBS_MSG("DatalinkToken: Station %d holds a token too. Giving up.\n",
+             src);
+    tokenCounters_.duplicates++;
+    holdingToken_ = false;
+  }
+
+  if (FrameType(fields[0]) == FrameType::TOKEN) {
+    if (frame.payload.getPtr()[0] == station_) {
+      tokenCounters_.received++;
+      holdingToken_ = true;
+      holdStart_ = Core::NowNs();
+      successor_ = nextStation(station_);
+    }
+  } else {
+    receiveCounters_.received++;
+    receiveHandlers_.callHandlers(frame);
+  }
+}
+
+uint8_t DatalinkToken::nextStation(uint8_t station) const {
+  return station + 1 < numStations_ ? station + 1 : 0;
+}
+
+void DatalinkToken::taskCheck() {
+
+  auto now = Core::NowNs();
+  // A single station keeps the token for good. It only needs to run once
+  // frames are queued.
+  auto tokenWork =
+      holdingToken_ && (numStations_ > 1 || transmitBuffer_.size() > 0);
+  if (wakeupPending_ || tokenWork || isTransmitting() ||
+      (awaitingSuccessor_ && now - passTime_ > passTimeout_) ||
+      (isReceiving() && now - lastActivity_ > passTimeout_) ||
+      (!holdingToken_ && !awaitingSuccessor_ &&
+       now - lastActivity_ > lossTimeout_ + station_ * passTimeout_) ||
+      (pollPhysical_ && physicalLayer_->readable() > 0)) {
+    setRelease(now);
+  }
+}
+
+} // namespace VCTR::network::datalink
@@ -0,0 +1,154 @@
+#include <cstring>
+
+#include "ExVectrNetwork/FrameRing.hpp"
+
+namespace VCTR::network {
+
+FrameRing::FrameRing(uint8_t *storage, size_t capacity)
+    : storage_(storage), capacity_(capacity) {}
+
+void FrameRing::setStorage(uint8_t *storage, size_t capacity) {
+  storage_ = storage;
+  capacity_ = capacity;
+  clear();
+}
+
+bool FrameRing::push(const uint8_t *data, size_t size) {
+  if (size > freeSpace() || !begin())
+    return false;
+
+  append(data, size);
+  commit();
+  return true;
+}
+
+bool FrameRing::begin() {
+  abort();
+  if (unused() < recordHeaderSize)
+    return false;
+
+  // The length is written on commit, when it is known.
+  open_ = true;
+  openSize_ = 0;
+  return true;
+}
+
+size_t FrameRing::append(const uint8_t *data, size_t size) {
+  if (!open_)
+    return 0;
+
+  auto space = unused() - recordHeaderSize - openSize_;
+  if (size > space)
+    size = space;
+  if (size > UINT16_MAX - openSize_)
+    size = UINT16_MAX - openSize_;
+
+  write(advance(head_, used_ + recordHeaderSize + openSize_), data, size);
+  openSize_ += size;
+  return size;
+}
+
+void FrameRing::commit() {
+  if (!open_)
+    return;
+
+  const uint8_t length[recordHeaderSize] = {uint8_t(openSize_ >> 8),
+                                            uint8_t(openSize_)};
+  write(advance(head_, used_), length, recordHeaderSize);
+  used_ += recordHeaderSize + openSize_;
+  numFrames_++;
+  abort();
+}
+
+void FrameRing::abort() {
+  open_ = false;
+  openSize_ = 0;
+}
+
+size_t FrameRing::frontSize() const {
+  if (numFrames_ == 0)
+    return 0;
+
+  uint8_t length[recordHeaderSize];
+  read(head_, length, recordHeaderSize);
+  return size_t(length[0]) << 8 | length[1];
+}
+
+size_t FrameRing::copyFront(uint8_t *buffer) const {
+  return readFront(0, buffer, frontSize());
+}
+
+size_t FrameRing::readFront(size_t offset, uint8_t *buffer,
+                            size_t size) const {
+  auto frameSize = frontSize();
+  if (offset >= frameSize)
+    return 0;
+  if (size > frameSize - offset)
+    size = frameSize - offset;
+
+  read(advance(head_, recordHeaderSize + offset), buffer, size);
+  return size;
+}
+
+const uint8_t *FrameRing::peekFront(size_t offset, size_t &size) const {
+  auto frameSize = frontSize();
+  if (offset >= frameSize) {
+    size = 0;
+    return nullptr;
+  }
+
+  auto index = advance(head_, recordHeaderSize + offset);
+  size = frameSize - offset;
+  if (size > capacity_ - index)
+    size = capacity_ - index;
+  return storage_ + index;
+}
+
+void FrameRing::pop() {
+  if (numFrames_ == 0)
+    return;
+
+  auto size = recordHeaderSize + frontSize();
+  head_ = advance(head_, size);
+  used_ -= size;
+  numFrames_--;
+}
+
+void FrameRing::clear() {
+  head_ = used_ = numFrames_ = 0;
+  abort();
+}
+
+size_t FrameRing::freeSpace() const {
+  auto space = unused();
+  return space > recordHeaderSize ? space - recordHeaderSize : 0;
+}
+
+void FrameRing::write(size_t index, const uint8_t *data, size_t size) {
+  if (size == 0)
+    return;
+  auto first = capacity_ - index;
+  if (first > size)
+    first = size;
+  std::memcpy(storage_ + index, data, first);
+  std::memcpy(storage_, data + first, size - first);
+}
+
+void FrameRing::read(size_t index, uint8_t *data, size_t size) const {
+  if (size == 0)
+    return;
+  auto first = capacity_ - index;
+  if (first > size)
+    first = size;
+  std::memcpy(data, storage_ + index, first);
+  std::memcpy(data + first, storage_, size - first);
+}
+
+size_t FrameRing::advance(size_t index, size_t size) const {
+  index += size;
+  return index >= capacity_ ? index - capacity_ : index;
+}
+
+size_t FrameRing::unused() const { return capacity_ - used_; }
+
+} // namespace VCTR::network
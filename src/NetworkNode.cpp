@@ -10,32 +10,54 @@
 #include "ExVectrNetwork/network/NetworkNode.hpp"
 
 namespace VCTR::network::network {
-NetworkNode::NetworkNode(uint16_t nodeAddress, int64_t disconnectTimeout)
+NetworkNode::NetworkNode(uint16_t nodeAddress, NodeInfo *nodeStorage,
+                         size_t maxNeighbours,
+                         datalink::DatalinkI **datalinkStorage,
+                         size_t maxDatalinks, int64_t disconnectTimeout)
     : NetworkI(nodeAddress),
-      Task_Periodic("NetworkNode", 100 * Core::MILLISECONDS) // 10Hz
-{
+      Task_Periodic("NetworkNode", 100 * Core::MILLISECONDS), // 10Hz
+      datalinks_(datalinkStorage, maxDatalinks),
+      nodeList_(nodeStorage, maxNeighbours) {
   timeoutInterval_ = disconnectTimeout;
-  sendInterval_ =
-      timeoutInterval_ /
-      10; // Send a heartbeat packet every 1/5 of the timeout interval.
 
   Core::getSystemScheduler().addTask(*this);
 }
 
+#ifndef EXVECTRNETWORK_STATIC_ALLOCATION
+NetworkNode::NetworkNode(uint16_t nodeAddress, int64_t disconnectTimeout)
+    : NetworkNode(nodeAddress, new NodeInfo[defaultMaxNeighbours],
+                  defaultMaxNeighbours,
+                  new datalink::DatalinkI *[defaultMaxDatalinks],
+                  defaultMaxDatalinks, disconnectTimeout) {
+  ownsStorage_ = true;
+}
+
 NetworkNode::NetworkNode(uint16_t nodeAddress, datalink::DatalinkI &datalink,
                          int64_t disconnectTimeout)
     : NetworkNode(nodeAddress, disconnectTimeout) {
   addDatalink(datalink);
 }
+#endif
 
-// NetworkNode::~NetworkNode()
-//{
-// }
+NetworkNode::~NetworkNode() {
+  if (ownsStorage_) {
+    delete[] nodeList_.getPtr();
+    delete[] datalinks_.getPtr();
+  }
+}
 
-void NetworkNode::addDatalink(datalink::DatalinkI &datalink) {
-  datalinks_.append(&datalink);
+bool NetworkNode::addDatalink(datalink::DatalinkI &datalink) {
+  if (!datalinks_.append(&datalink)) {
+    LOG_MSG("Maximum number of datalinks reached! \n");
+    return false;
+  }
   datalink.addReceiveHandler(
       [this](const DataPacket &dataframe) { receivePacket(dataframe); });
+  return true;
+}
+
+void NetworkNode::setHeartbeatInterval(int64_t interval) {
+  sendInterval_ = interval;
 }
 
 bool NetworkNode::isNodeReachable(uint16_t nodeAddress) {
@@ -49,14 +71,16 @@ bool NetworkNode::isNodeReachable(uint16_t nodeAddress) {
 
 void NetworkNode::taskThread() {
 
-  if (Core::NowNs() - lastSend_ > sendInterval_) {
+  if (sendInterval_ > 0 && Core::NowNs() - lastSend_ > sendInterval_) {
     lastSend_ = Core::NowNs();
     NetworkPacketHeader header;
     header.type = NetworkPacketType::HEARTBEAT;
     header.hops = 0;
     header.dstAddress = 0xFFFF; // Broadcast to all nodes.
     header.srcAddress = nodeAddress_;
-    sendPacket(header);
+    DataPacket packet;
+    packet.priority = Priority::CONTROL;
+    sendPacket(header, packet);
   }
 
   // Check if any nodes are unreachable
@@ -69,9 +93,10 @@ void NetworkNode::taskThread() {
 }
 
 void NetworkNode::sendPacket(const NetworkPacketHeader &header,
-                             const Core::ListArray<uint8_t> &payload) {
+                             DataPacket &packet) {
 
-  if (payload.size() == 0) {
+  // Only heartbeats and other control packets may be empty.
+  if (packet.payload.size() == 0 && header.type == NetworkPacketType::DATA) {
     LOG_MSG("Packet empty! \n");
     return;
   }
@@ -83,17 +108,57 @@ void NetworkNode::sendPacket(const NetworkPacketHeader &header,
   if (nodeAddress_ ==
       header.dstAddress) { // If this packet is for this node, publish it
                            // directly to the receive topic.
-    packetReceiveHandlers_.callHandlers(header, payload);
+    packetReceiveHandlers_.callHandlers(
+        header, PacketView(packet.payload.getPtr(), packet.payload.size(),
+                           packet.timestamp, &packet.payload));
+    return;
+  }
+
+  // Header goes into the tailroom of the packet. No copy of the payload.
+  if (!headerSend.addHeader(packet)) {
+    LOG_MSG("No space for the header! \n");
+    return;
+  }
+
+  // Datalinks queue copies of the packet. Make them share the storage.
+  if (datalinks_.size() > 1)
+    packet.payload.makeShareable();
+
+  for (size_t i = 0; i < datalinks_.size(); i++) {
+    datalinks_[i]->transmitDataframe(packet);
+  }
+  lastSend_ = Core::NowNs(); // Update the last send time.
+}
+
+void NetworkNode::sendPacket(const NetworkPacketHeader &header,
+                             PacketChain &chain) {
+
+  if (chain.size() == 0) {
+    LOG_MSG("Packet empty! \n");
+    return;
+  }
+
+  // Local delivery and multiple datalinks need a contiguous packet.
+  if (nodeAddress_ == header.dstAddress || datalinks_.size() > 1) {
+    DataPacket packet(chain.size());
+    if (packet.payload.size() != chain.size()) {
+      LOG_MSG("No space to gather packet! \n");
+      return;
+    }
+    chain.copyTo(packet.payload.getPtr());
+    packet.timestamp = chain.timestamp;
+    packet.priority = chain.priority;
+    sendPacket(header, packet);
     return;
   }
 
-  // LOG_MSG("Packet input size: %d, Packet copy size: %d\n",
-  // packet.payload.size(), packetSend.payload.size());
-  DataPacket packetSend;
-  headerSend.addHeader(packetSend);
+  auto headerSend = header;
+  headerSend.srcAddress = nodeAddress_;
+  if (!headerSend.addHeader(chain))
+    return;
 
   for (size_t i = 0; i < datalinks_.size(); i++) {
-    datalinks_[i]->transmitDataframe(packetSend);
+    datalinks_[i]->transmitDataframe(chain);
   }
   lastSend_ = Core::NowNs(); // Update the last send time.
 }
@@ -132,7 +197,8 @@ void NetworkNode::receivePacket(const DataPacket &data) {
     NodeInfo nodeInfo;
     nodeInfo.nodeAddress = header.srcAddress;
     nodeInfo.lastSeen = Core::NowNs();
-    nodeList_.appendIfNotInListArray(nodeInfo);
+    if (!nodeList_.append(nodeInfo))
+      VRBS_MSG("Node list full. Ignoring node %d. \n", header.srcAddress);
   }
 
   if (header.type == NetworkPacketType::HEARTBEAT) {
@@ -149,9 +215,13 @@ void NetworkNode::receivePacket(const DataPacket &data) {
     if (header.hops > 0)
       header.hops--;
 
-    // Send packet to receive topic (Network -> Transport)
-    auto payload = data.payload;
-    payload.popDiscard(header.getHeaderSize());
+    // Send packet to receive topic (Network -> Transport). The header is at
+    // the back, so the payload is simply the front of the frame. Handlers can
+    // keep the frame through the view. Only inline frames are copied.
+    PacketView payload(data.payload.getPtr(),
+                       data.payload.size() - header.getHeaderSize(),
+                       data.timestamp, &data.payload);
+    payload.metadata = data.metadata;
     packetReceiveHandlers_.callHandlers(header, payload);
   }
 }
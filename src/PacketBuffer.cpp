@@ -0,0 +1,225 @@
+#include <cstring>
+
+#include "ExVectrCore/print.hpp"
+
+#include "ExVectrNetwork/PacketBuffer.hpp"
+#include "ExVectrNetwork/PacketPool.hpp"
+#include "ExVectrNetwork/PacketView.hpp"
+
+namespace VCTR::network {
+
+PacketBuffer::PacketBuffer(size_t size, size_t tailroom) {
+  if (reserve(size + tailroom) || reserve(size))
+    size_ = size;
+}
+
+PacketBuffer::PacketBuffer(const uint8_t *data, size_t size, size_t tailroom)
+    : PacketBuffer(size, tailroom) {
+  if (size_ > 0)
+    std::memcpy(data_, data, size_);
+}
+
+PacketBuffer::PacketBuffer(const PacketBuffer &other) : pool_(other.pool_) {
+  if (other.storage_ != nullptr && other.getRefCount() < UINT16_MAX) {
+    storage_ = other.storage_;
+    data_ = other.data_;
+    capacity_ = other.capacity_;
+    storagePool_ = other.storagePool_;
+    setRefCount(getRefCount() + 1);
+    size_ = other.size_;
+  } else if (reserve(other.capacity_) || reserve(other.size_)) {
+    if (other.size_ > 0)
+      std::memcpy(data_, other.data_, other.size_);
+    size_ = other.size_;
+  }
+}
+
+PacketBuffer &PacketBuffer::operator=(const PacketBuffer &other) {
+  if (this == &other)
+    return *this;
+
+  PacketBuffer copy(other);
+  swap(copy);
+  return *this;
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer &&other) { takeContent(other); }
+
+PacketBuffer &PacketBuffer::operator=(PacketBuffer &&other) {
+  if (this != &other)
+    takeContent(other);
+  return *this;
+}
+
+PacketBuffer::PacketBuffer(const PacketView &view) {
+  auto buffer = view.getBuffer();
+  if (buffer != nullptr && !buffer->isInline() &&
+      view.getPtr() == buffer->data_ && view.size() <= buffer->size_) {
+    PacketBuffer shared(*buffer);
+    takeContent(shared);
+    size_ = view.size();
+    return;
+  }
+
+  append(view.getPtr(), view.size());
+}
+
+PacketBuffer::~PacketBuffer() { freeStorage(); }
+
+bool PacketBuffer::reserve(size_t capacity) {
+  if (capacity <= capacity_ && !isShared())
+    return true;
+
+  return reallocate(capacity > capacity_ ? capacity : capacity_, true);
+}
+
+bool PacketBuffer::reserveTailroom(size_t bytes) {
+  return reserve(size_ + bytes);
+}
+
+bool PacketBuffer::setSize(size_t size) {
+  if (size > size_ && !reserve(size))
+    return false;
+  size_ = size;
+  return true;
+}
+
+uint8_t *PacketBuffer::push(size_t bytes) {
+  if (bytes > tailroom()) {
+    // Grow geometrically so repeated pushes do not reallocate every time.
+    auto capacity = capacity_ + capacity_ / 2;
+    if (capacity < size_ + bytes)
+      capacity = size_ + bytes;
+    if (!reserve(capacity) && !reserve(size_ + bytes))
+      return nullptr;
+  } else {
+    makeUnique();
+  }
+
+  auto ptr = data_ + size_;
+  size_ += bytes;
+  return ptr;
+}
+
+void PacketBuffer::popDiscard(size_t bytes) {
+  size_ = bytes < size_ ? size_ - bytes : 0;
+}
+
+bool PacketBuffer::append(uint8_t byte) {
+  auto ptr = push(1);
+  if (ptr == nullptr)
+    return false;
+  *ptr = byte;
+  return true;
+}
+
+bool PacketBuffer::append(const uint8_t *data, size_t size) {
+  if (size == 0)
+    return true;
+
+  auto ptr = push(size);
+  if (ptr == nullptr)
+    return false;
+  std::memcpy(ptr, data, size);
+  return true;
+}
+
+void PacketBuffer::reset() {
+  freeStorage();
+  size_ = 0;
+}
+
+void PacketBuffer::swap(PacketBuffer &other) {
+  if (this == &other)
+    return;
+
+  PacketBuffer temp;
+  temp.takeContent(*this);
+  takeContent(other);
+  other.takeContent(temp);
+}
+
+void PacketBuffer::makeShareable() {
+  if (isInline())
+    reallocate(capacity_, false);
+}
+
+bool PacketBuffer::reallocate(size_t capacity, bool allowInline) {
+  uint8_t *storage = nullptr;
+  PacketPool *storagePool = nullptr;
+
+  if (!(allowInline && capacity <= inlineCapacity)) {
+    const auto storageSize = capacity + storageHeaderSize;
+    if (pool_ != nullptr &&
+        (storage = pool_->acquire(storageSize)) != nullptr) {
+      storagePool = pool_;
+      capacity = pool_->getSlotSize() - storageHeaderSize; // Use whole slot.
+    } else {
+#ifdef EXVECTRNETWORK_STATIC_ALLOCATION
+      VRBS_MSG("No pool storage for %d bytes. Failure.\n", capacity);
+      return false;
+#else
+      storage = new uint8_t[storageSize];
+#endif
+    }
+  }
+
+  uint8_t *data = storage != nullptr ? storage + storageHeaderSize : inline_;
+  if (size_ > 0 && data != data_)
+    std::memmove(data, data_, size_);
+
+  // Keep the size, as freeStorage() only drops the reference.
+  auto size = size_;
+  freeStorage();
+  size_ = size;
+
+  storage_ = storage;
+  data_ = data;
+  capacity_ = storage != nullptr ? capacity : inlineCapacity;
+  storagePool_ = storagePool;
+  if (storage_ != nullptr)
+    setRefCount(1);
+  return true;
+}
+
+void PacketBuffer::freeStorage() {
+  if (storage_ != nullptr) {
+    auto count = getRefCount();
+    if (count > 1) {
+      setRefCount(count - 1);
+    } else if (storagePool_ != nullptr) {
+      storagePool_->release(storage_);
+    } else {
+      delete[] storage_;
+    }
+  }
+
+  storage_ = nullptr;
+  data_ = inline_;
+  capacity_ = inlineCapacity;
+  storagePool_ = nullptr;
+}
+
+void PacketBuffer::takeContent(PacketBuffer &other) {
+  freeStorage();
+  pool_ = other.pool_;
+
+  if (other.isInline()) {
+    if (other.size_ > 0)
+      std::memcpy(inline_, other.inline_, other.size_);
+  } else {
+    storage_ = other.storage_;
+    data_ = other.data_;
+    capacity_ = other.capacity_;
+    storagePool_ = other.storagePool_;
+    other.storage_ = nullptr;
+    other.data_ = other.inline_;
+    other.capacity_ = inlineCapacity;
+    other.storagePool_ = nullptr;
+  }
+
+  size_ = other.size_;
+  other.size_ = 0;
+}
+
+} // namespace VCTR::network
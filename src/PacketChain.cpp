@@ -0,0 +1,82 @@
+#include <cstring>
+
+#include "ExVectrCore/print.hpp"
+
+#include "ExVectrNetwork/PacketChain.hpp"
+
+namespace VCTR::network {
+
+bool PacketChain::append(const uint8_t *data, size_t size) {
+  if (size == 0)
+    return true;
+
+  if (numFragments_ >= maxFragments || size > UINT16_MAX) {
+    LOG_MSG("Packet chain is full. Failure.\n");
+    return false;
+  }
+
+  fragments_[numFragments_++] = {data, 0, uint16_t(size)};
+  size_ += size;
+  return true;
+}
+
+uint8_t *PacketChain::push(size_t size) {
+  if (size > localCapacity - localSize_) {
+    LOG_MSG("Packet chain has no space for %d bytes. Failure.\n", size);
+    return nullptr;
+  }
+
+  // Grow the last fragment if it is the end of the local buffer.
+  auto last = numFragments_ > 0 ? &fragments_[numFragments_ - 1] : nullptr;
+  if (last != nullptr && last->data == nullptr &&
+      last->offset + last->size == localSize_) {
+    last->size += size;
+  } else if (numFragments_ < maxFragments) {
+    fragments_[numFragments_++] = {nullptr, uint8_t(localSize_),
+                                   uint16_t(size)};
+  } else {
+    LOG_MSG("Packet chain is full. Failure.\n");
+    return nullptr;
+  }
+
+  auto ptr = local_ + localSize_;
+  localSize_ += size;
+  size_ += size;
+  return ptr;
+}
+
+PacketView PacketChain::getFragment(size_t index) const {
+  const auto &fragment = fragments_[index];
+  auto data =
+      fragment.data != nullptr ? fragment.data : local_ + fragment.offset;
+  return PacketView(data, fragment.size, timestamp);
+}
+
+size_t PacketChain::copyTo(uint8_t *buffer, size_t offset, size_t size) const {
+  size_t copied = 0;
+
+  for (size_t i = 0; i < numFragments_ && copied < size; i++) {
+    auto fragment = getFragment(i);
+    if (offset >= fragment.size()) {
+      offset -= fragment.size();
+      continue;
+    }
+
+    auto length = fragment.size() - offset;
+    if (length > size - copied)
+      length = size - copied;
+    std::memcpy(buffer + copied, fragment.getPtr() + offset, length);
+    copied += length;
+    offset = 0;
+  }
+
+  return copied;
+}
+
+void PacketChain::clear() {
+  numFragments_ = 0;
+  localSize_ = 0;
+  size_ = 0;
+}
+
+} // namespace VCTR::network
@@ -0,0 +1,62 @@
+#include <cstring>
+
+#include "ExVectrCore/print.hpp"
+
+#include "ExVectrNetwork/PacketPool.hpp"
+
+namespace VCTR::network {
+
+PacketPool::PacketPool(uint8_t *storage, size_t slotSize, size_t numSlots)
+    : storage_(storage), slotSize_(slotSize), numSlots_(numSlots) {
+
+  // Link all slots into the free list, first slot at the front.
+  for (size_t i = numSlots_; i > 0; i--) {
+    auto slot = storage_ + (i - 1) * slotSize_;
+    std::memcpy(slot, &freeList_, sizeof(freeList_));
+    freeList_ = slot;
+  }
+  numFree_ = minFree_ = numSlots_;
+}
+
+uint8_t *PacketPool::acquire(size_t size) {
+  if (size > slotSize_)
+    return nullptr;
+
+  if (freeList_ == nullptr) {
+    exhaustedCount_++;
+    VRBS_MSG("Packet pool exhausted. Count: %d\n", exhaustedCount_);
+    return nullptr;
+  }
+
+  auto slot = freeList_;
+  std::memcpy(&freeList_, slot, sizeof(freeList_));
+  numFree_--;
+  if (numFree_ < minFree_)
+    minFree_ = numFree_;
+
+  return slot;
+}
+
+void PacketPool::release(uint8_t *slot) {
+  if (!owns(slot)) {
+    LOG_MSG("Released slot is not from this pool!\n");
+    return;
+  }
+
+  std::memcpy(slot, &freeList_, sizeof(freeList_));
+  freeList_ = slot;
+  numFree_++;
+}
+
+bool PacketPool::owns(const uint8_t *ptr) const {
+  return ptr >= storage_ && ptr < storage_ + slotSize_ * numSlots_ &&
+         (ptr - storage_) % slotSize_ == 0;
+}
+
+PacketPool &getDefaultPacketPool() {
+  static PacketPoolStatic<defaultPacketPoolSlotSize, defaultPacketPoolNumSlots>
+      pool;
+  return pool;
+}
+
+} // namespace VCTR::network
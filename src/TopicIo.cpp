@@ -26,9 +26,11 @@ void TopicIO::receiveItem(const Core::List<uint8_t> &item) {
   VRBS_MSG("Received %d bytes from topic to send This: %d.\n", item.size(),
            this);
 
-  for (uint8_t i = 0; i < item.size(); i++) {
+  for (size_t i = 0; i < item.size(); i++) {
     receiveBuffer_.placeBack(item[i]);
   }
+
+  signalReady();
 }
 
 void TopicIO::setTopicIO(Core::Topic<const Core::List<uint8_t> &> &topic) {
@@ -83,11 +85,11 @@ bool TopicIO::setOutputParam(HAL::IO_PARAM_t param, int32_t value) {
   return false;
 }
 
-size_t TopicIO::writable() { return 255; }
+size_t TopicIO::writable() { return bufferSize; }
 
 size_t TopicIO::writeData(const void *data, size_t size, bool endTransfer) {
 
-  if (size > 255) // Too big to send
+  if (size > bufferSize) // Too big to send
     return 0;
 
   VRBS_MSG("Sending %d bytes through topic. This: %d\n", size, this);
@@ -0,0 +1,164 @@
+#include <cstring>
+
+#include "ExVectrNetwork/datalink/TransmitQueue.hpp"
+
+namespace VCTR::network::datalink {
+
+TransmitQueue::TransmitQueue(uint8_t *storage, size_t size)
+    : rings_{{nullptr, 0}, {nullptr, 0}, {nullptr, 0}} {
+  setStorage(storage, size);
+}
+
+void TransmitQueue::setStorage(uint8_t *storage, size_t size) {
+  auto control = size / 4;
+  auto normal = size / 2;
+  rings_[index(Priority::CONTROL)].setStorage(storage, control);
+  rings_[index(Priority::NORMAL)].setStorage(storage + control, normal);
+  rings_[index(Priority::BULK)].setStorage(storage + control + normal,
+                                           size - control - normal);
+  clear();
+}
+
+bool TransmitQueue::push(const DataPacket &frame) {
+  auto len = frame.payload.size();
+  if (!begin(frame.priority, len, frame.timestamp))
+    return false;
+
+  append(frame.payload.getPtr(), len);
+  commit();
+  return true;
+}
+
+bool TransmitQueue::begin(Priority priority, size_t size, int64_t timestamp) {
+  if (size > freeSpace(priority))
+    return false;
+
+  open_ = index(priority);
+  auto &ring = rings_[open_];
+  if (!ring.begin())
+    return false;
+
+  uint8_t time[timestampSize];
+  std::memcpy(time, &timestamp, timestampSize);
+  ring.append(time, timestampSize);
+  return true;
+}
+
+void TransmitQueue::append(const uint8_t *data, size_t size) {
+  rings_[open_].append(data, size);
+}
+
+void TransmitQueue::commit() { rings_[open_].commit(); }
+
+bool TransmitQueue::take() {
+  if (hasTaken())
+    return true;
+  if (size() == 0)
+    return false;
+
+  taken_ = select();
+  return true;
+}
+
+size_t TransmitQueue::takenSize() const {
+  if (!hasTaken())
+    return 0;
+  return rings_[taken_].frontSize() - timestampSize;
+}
+
+int64_t TransmitQueue::takenTimestamp() const {
+  if (!hasTaken())
+    return 0;
+
+  uint8_t time[timestampSize];
+  rings_[taken_].readFront(0, time, timestampSize);
+  int64_t timestamp;
+  std::memcpy(&timestamp, time, timestampSize);
+  return timestamp;
+}
+
+const uint8_t *TransmitQueue::peekTaken(size_t offset, size_t &size) const {
+  if (!hasTaken()) {
+    size = 0;
+    return nullptr;
+  }
+  return rings_[taken_].peekFront(timestampSize + offset, size);
+}
+
+size_t TransmitQueue::readTaken(size_t offset, uint8_t *buffer,
+                                size_t size) const {
+  if (!hasTaken())
+    return 0;
+  return rings_[taken_].readFront(timestampSize + offset, buffer, size);
+}
+
+void TransmitQueue::release() {
+  if (!hasTaken())
+    return;
+
+  auto len = takenSize();
+  deficits_[taken_] = deficits_[taken_] > len ? deficits_[taken_] - len : 0;
+  rings_[taken_].pop();
+  taken_ = numPriorities;
+}
+
+size_t TransmitQueue::frontSize() {
+  if (hasTaken())
+    return takenSize();
+  if (size() == 0)
+    return 0;
+  return rings_[select()].frontSize() - timestampSize;
+}
+
+size_t TransmitQueue::size() const {
+  size_t frames = 0;
+  for (auto &ring : rings_)
+    frames += ring.numFrames();
+  return frames;
+}
+
+size_t TransmitQueue::freeSpace(Priority priority) const {
+  auto &ring = rings_[index(priority)];
+  if (ring.numFrames() >= capacity_)
+    return 0;
+
+  auto space = ring.freeSpace();
+  if (space <= timestampSize)
+    return 0;
+  space -= timestampSize;
+  return space < maxFrameSize ? space : maxFrameSize;
+}
+
+void TransmitQueue::clear() {
+  for (size_t c = 0; c < numPriorities; c++) {
+    rings_[c].clear();
+    deficits_[c] = 0;
+  }
+  taken_ = numPriorities;
+  current_ = 0;
+}
+
+size_t TransmitQueue::select() {
+  if (scheduling_ == TransmitScheduling::STRICT || size() == 0) {
+    for (size_t c = 0; c < numPriorities; c++) {
+      if (rings_[c].numFrames() > 0)
+        return c;
+    }
+    return 0;
+  }
+
+  // A class keeps the deficit it did not use while it has frames waiting.
+  // The deficit grows each round, so this ends at a waiting class.
+  while (true) {
+    auto &ring = rings_[current_];
+    if (ring.numFrames() > 0 &&
+        deficits_[current_] >= ring.frontSize() - timestampSize)
+      return current_;
+    if (ring.numFrames() == 0)
+      deficits_[current_] = 0;
+    current_ = (current_ + 1) % numPriorities;
+    deficits_[current_] += quantum * weights_[current_];
+  }
+}
+
+} // namespace VCTR::network::datalink
@@ -1,4 +1,6 @@
-#include "ExVectrCore/cyclic_checksum.hpp"
+#include <cstring>
+#include <utility>
+
 #include "ExVectrCore/list.hpp"
 #include "ExVectrCore/list_array.hpp"
 #include "ExVectrCore/print.hpp"
@@ -6,8 +8,10 @@
 #include "ExVectrCore/topic.hpp"
 #include "ExVectrCore/topic_subscribers.hpp"
 
+#include "ExVectrNetwork/Crc.hpp"
 #include "ExVectrNetwork/network/NetworkI.hpp"
 #include "ExVectrNetwork/transport/TransportCallback.hpp"
+#include "ExVectrNetwork/transport/TransportHeader.hpp"
 
 /**
  * The transport simple works by breaking up the data into segments and sending
@@ -20,7 +24,11 @@
  * Specifically each packet MUST append the following 8 bytes: [srcPortHigh,
  * srcPortLow, dstPortHigh, dstPortLow, orderHigh, orderLow, ID,
  * transportIdentifier] A packet with order 0 is the info packet and contains
- * the number of segments, bytes, checksum and ID.
+ * the number of segments and bytes. The CRC-32 of the data is appended behind
+ * the data of the last segment. Both ends fold each segment into the CRC as it
+ * is sent or placed, so nothing has to pass over the whole data again. The
+ * receiver shifts each segment CRC by its position, which lets segments arrive
+ * in any order.
  */
 
 namespace VCTR::network::transport {
@@ -41,7 +49,7 @@ void TransportCallback::setNetworkNode(VCTR::network::network::NetworkI &node) {
   netNode_ = &node;
   netNode_->addPacketReceiveHandler(
       [this](const VCTR::network::network::NetworkPacketHeader &header,
-             const Core::ListArray<uint8_t> &payload) {
+             const PacketView &payload) {
         receivePacketCallback(header, payload);
       });
 }
@@ -49,85 +57,168 @@ void TransportCallback::setNetworkNode(VCTR::network::network::NetworkI &node) {
 void TransportCallback::setPort(uint16_t port) { port_ = port; }
 uint16_t TransportCallback::getPort() { return port_; }
 
+void TransportCallback::setReassemblyPool(PacketPool *pool,
+                                          size_t maxDataSize) {
+  reassemblyPool_ = pool;
+  maxDataSize_ = maxDataSize;
+}
+
+Core::Topic<TransportCallback::TransportData> &
+TransportCallback::getReceiveTopic() {
+  return receiveTopic_;
+}
+
+Core::Topic<TransportCallback::TransportData> &
+TransportCallback::getTransmitTopic() {
+  return transmitTopic_;
+}
+
 /**
  * @brief   Sends the given data to the given address and port.
  * @param data The data to send and the destination address and port. The source
  * address and port will be added automatically.
+ * @param priority Transmit priority of all segments.
  */
 void TransportCallback::send(const Core::List<uint8_t> &data,
-                             uint16_t dstAddress, uint16_t dstPort) {
+                             uint16_t dstAddress, uint16_t dstPort,
+                             Priority priority) {
 
   if (data.size() == 0) {
     LOG_MSG("Data is null. \n");
     return;
   }
 
-  // Calculate number of segments
+  if (data.size() > UINT16_MAX) {
+    LOG_MSG("Data is too large. %d bytes. \n", data.size());
+    return;
+  }
+
   uint16_t numBytes = data.size();
+  auto header = sendInfoSegment(numBytes, dstAddress, dstPort, priority);
+
+  // A list is not guaranteed to be contiguous, so each segment is copied once.
+  uint8_t segment[segmentSize];
+  PacketChain chain;
+  chain.priority = priority;
+  uint32_t crc = 0;
+  for (uint16_t i = 0; i * segmentSize < numBytes; i++) {
+
+    size_t length = 0;
+    for (; length < segmentSize && i * segmentSize + length < numBytes;
+         length++) {
+      segment[length] = data[i * segmentSize + length];
+    }
+
+    VRBS_MSG("Sending data segment %d. \n", i + 1);
+
+    crc = crc::crc32(segment, length, crc);
+    chain.clear();
+    chain.append(segment, length);
+    if ((i + 1) * segmentSize >= numBytes)
+      addChecksum(chain, crc);
+    sendSegment(header, chain, i + 1, dstPort, sendingID_);
+  }
+
+  // Increment the sending ID
+  sendingID_++;
+}
+
+void TransportCallback::send(const uint8_t *data, size_t size,
+                             uint16_t dstAddress, uint16_t dstPort,
+                             Priority priority) {
+
+  if (size == 0) {
+    LOG_MSG("Data is null. \n");
+    return;
+  }
+
+  if (size > UINT16_MAX) {
+    LOG_MSG("Data is too large. %d bytes. \n", size);
+    return;
+  }
+
+  uint16_t numBytes = size;
+  auto header = sendInfoSegment(numBytes, dstAddress, dstPort, priority);
+
+  // Segments point into the data. Nothing is copied here.
+  PacketChain chain;
+  chain.priority = priority;
+  uint32_t crc = 0;
+  for (uint16_t i = 0; i * segmentSize < numBytes; i++) {
+
+    size_t length = numBytes - i * segmentSize;
+    if (length > segmentSize)
+      length = segmentSize;
+
+    VRBS_MSG("Sending data segment %d. \n", i + 1);
+
+    crc = crc::crc32(data + i * segmentSize, length, crc);
+    chain.clear();
+    chain.append(data + i * segmentSize, length);
+    if (i * segmentSize + length >= numBytes)
+      addChecksum(chain, crc);
+    sendSegment(header, chain, i + 1, dstPort, sendingID_);
+  }
+
+  // Increment the sending ID
+  sendingID_++;
+}
+
+VCTR::network::network::NetworkPacketHeader
+TransportCallback::sendInfoSegment(uint16_t numBytes, uint16_t dstAddress,
+                                   uint16_t dstPort, Priority priority) {
+
+  // Calculate number of segments
   uint16_t numSegments = numBytes / segmentSize;
-  uint16_t finalSegmentSize = numBytes % segmentSize;
-  if (finalSegmentSize > 0) {
+  if (numBytes % segmentSize > 0) {
     numSegments++;
   }
 
-  // Calculate checksum of data.
-  uint8_t crc = Core::computeCrc(data, 0);
+  VRBS_MSG("Sending info segment. Segments: %d, Bytes: %d. \n", numSegments,
+           numBytes);
 
-  VRBS_MSG("Sending info segment. Segments: %d, Bytes: %d, Checksum: %d. \n",
-           numSegments, numBytes, crc);
-
-  // Create the first packet (Info packet)
   VCTR::network::network::NetworkPacketHeader header;
   header.type = VCTR::network::network::NetworkPacketType::DATA;
   header.srcAddress = netNode_->getNodeAddress();
   header.dstAddress = dstAddress;
   header.hops = 1;
 
-  Core::ListArray<uint8_t> packet;
-  packet.append(numSegments >> 8);
-  packet.append(numSegments & 0xFF);
-  packet.append(numBytes >> 8);
-  packet.append(numBytes & 0xFF);
-  packet.append(crc);
-  // Send the first packet
-  sendSegment(header, packet, 0, dstPort, sendingID_);
-
-  // Send the rest of the packets
-  for (uint16_t i = 0; i < numSegments; i++) {
-
-    packet.clear();
-
-    for (uint16_t j = 0; j < segmentSize; j++) {
-      if (i * segmentSize + j >= numBytes) {
-        break;
-      }
-      packet.append(data[i * segmentSize + j]);
-    }
+  PacketChain chain;
+  chain.priority = priority;
+  auto info = chain.push(4);
+  info[0] = numSegments >> 8;
+  info[1] = numSegments & 0xFF;
+  info[2] = numBytes >> 8;
+  info[3] = numBytes & 0xFF;
+  sendSegment(header, chain, 0, dstPort, sendingID_);
 
-    VRBS_MSG("Sending data segment %d. \n", i + 1);
-
-    sendSegment(header, packet, i + 1, dstPort, sendingID_);
-  }
+  return header;
+}
 
-  // Increment the sending ID
-  sendingID_++;
+void TransportCallback::addChecksum(PacketChain &chain, uint32_t crc) {
+  auto trailer = chain.push(checksumSize);
+  if (trailer == nullptr)
+    return;
+  trailer[0] = crc >> 24;
+  trailer[1] = crc >> 16;
+  trailer[2] = crc >> 8;
+  trailer[3] = crc;
 }
 
 void TransportCallback::sendSegment(
     const VCTR::network::network::NetworkPacketHeader &header,
-    Core::ListArray<uint8_t> &data, uint16_t order, uint16_t dstPort,
-    uint8_t id) {
-
-  data.append(port_ >> 8);
-  data.append(port_ & 0xFF);
-  data.append(dstPort >> 8);
-  data.append(dstPort & 0xFF);
-  data.append(order >> 8);
-  data.append(order & 0xFF);
-  data.append(id);
-  data.append(transportSimpleVersion + transportSimpleID);
-
-  netNode_->sendPacket(header, data);
+    PacketChain &chain, uint16_t order, uint16_t dstPort, uint8_t id) {
+
+  TransportHeader segmentHeader;
+  segmentHeader.srcPort = port_;
+  segmentHeader.dstPort = dstPort;
+  segmentHeader.order = order;
+  segmentHeader.id = id;
+  segmentHeader.identifier = transportSimpleVersion + transportSimpleID;
+  if (!segmentHeader.addHeader(chain))
+    return;
+
+  netNode_->sendPacket(header, chain);
 }
 
 /**
@@ -136,27 +227,29 @@ void TransportCallback::sendSegment(
  */
 void TransportCallback::receivePacketCallback(
     const VCTR::network::network::NetworkPacketHeader &header,
-    const Core::ListArray<uint8_t> &payload) {
+    const PacketView &payload) {
 
-  if (payload.size() < 8) { // Packet is too small. Discard.
+  // Segment info is appended to the end of the packet
+  TransportHeader segmentHeader;
+  if (!segmentHeader.fromView(payload)) { // Packet is too small. Discard.
     LOG_MSG("Received packet is too small. Its %d bytes long \n",
             payload.size());
     return;
   }
 
   // Check if packet is a transport packet and correct version
-  uint8_t identifier = payload(-1);
-  if (identifier != transportSimpleVersion + transportSimpleID) {
+  if (segmentHeader.identifier !=
+      transportSimpleVersion + transportSimpleID) {
     LOG_MSG("Received packet is not a transport packet. Identifier: %d. \n",
-            int(identifier));
+            int(segmentHeader.identifier));
     return;
   }
 
-  // Unpack the segment info appended to the end of the packet
-  uint16_t srcPort = (payload(-8) << 8) | payload(-7);
-  uint16_t dstPort = (payload(-6) << 8) | payload(-5);
-  uint16_t order = (payload(-4) << 8) | payload(-3);
-  uint8_t id = payload(-2);
+  // Unpack the segment info
+  uint16_t srcPort = segmentHeader.srcPort;
+  uint16_t dstPort = segmentHeader.dstPort;
+  uint16_t order = segmentHeader.order;
+  uint8_t id = segmentHeader.id;
 
   // Check if packet is for this port, if not return
   if (dstPort != port_) {
@@ -168,46 +261,96 @@ void TransportCallback::receivePacketCallback(
 
     uint16_t numSegments = (payload[0] << 8) | payload[1];
     uint16_t numBytes = (payload[2] << 8) | payload[3];
-    uint16_t checksum = payload[4];
 
     uint8_t rcvID = id;
 
     if (numSegments == 0 || numBytes == 0 ||
-        numBytes < numSegments) { // No data to receive or something is wrong
-                                  // with the data. Discard.
+        numSegments != (numBytes + segmentSize - 1) /
+                           segmentSize) { // No data to receive or something is
+                                          // wrong with the data. Discard.
       LOG_MSG("Received something wierd. Will be discarded. ID: %d, Segments: "
-              "%d, Bytes: %d, Checksum: %d. \n",
-              rcvID, numSegments, numBytes, checksum);
+              "%d, Bytes: %d. \n",
+              rcvID, numSegments, numBytes);
       // segmentBuffer_.clear();
       // curSegment_ = 0;
       // numSegments_ = numBytes_ = checksum_ = 0;
       return;
     }
 
+    if (numBytes > maxDataSize_) {
+      LOG_MSG("Received data is too large. Will be discarded. ID: %d, Bytes: "
+              "%d. \n",
+              rcvID, numBytes);
+      rcvID_ = rcvID;
+      curSegment_ = numBytes_ = numSegments_ = 0;
+      return;
+    }
+
     curSegment_ = 0;
 
     numSegments_ = numSegments;
     numBytes_ = numBytes;
-    checksum_ = checksum;
+    checksum_ = receivedCrc_ = 0;
     rcvID_ = rcvID;
-
-    if (receivedData_.size() < numBytes_) {
-      receivedData_.setSize(numBytes_);
+    std::memset(receivedSegments_, 0, (numSegments_ + 7) / 8);
+
+    // A single segment is taken over as is, see below.
+    receivedData_.reset();
+    receivedData_.setPool(reassemblyPool_);
+    if (numSegments_ > 1 && !receivedData_.setSize(numBytes_)) {
+      LOG_MSG("No storage for received data. Will be discarded. \n");
+      curSegment_ = numBytes_ = numSegments_ = 0;
+      return;
     }
 
-    VRBS_MSG("Received new data. Segments: %d, Bytes: %d, Checksum: %d. \n",
-             numSegments_, numBytes_, checksum_);
+    VRBS_MSG("Received new data. Segments: %d, Bytes: %d. \n", numSegments_,
+             numBytes_);
 
     return;
   }
+  // Data segments start at order 1.
+  size_t offset = (order - 1) * segmentSize;
+  if (order == 0 || offset >= numBytes_) { // Repeated info or bad segment.
+    return;
+  }
+
+  // The segment could have been repeated by a lower layer. Only place it once.
+  size_t index = order - 1;
+  if (index >= numSegments_ ||
+      receivedSegments_[index / 8] & (1 << (index % 8))) {
+    return;
+  }
+
   VRBS_MSG("Received data segment %d. \n", order);
 
   // Place the segment into the buffer.
-  for (size_t i = order * segmentSize;
-       i < (order + 1) * segmentSize && i < numBytes_; i++) {
-    receivedData_[i] = payload[i - order * segmentSize];
+  size_t available = payload.size() - TransportHeader::headerSize;
+  size_t length = available;
+  if (length > numBytes_ - offset)
+    length = numBytes_ - offset;
+
+  // The last segment carries the CRC of all data behind its own data.
+  if (offset + length == numBytes_) {
+    if (available < length + checksumSize) {
+      LOG_MSG("Last segment is missing the checksum. \n");
+      return;
+    }
+    auto trailer = payload.getPtr() + length;
+    checksum_ = uint32_t(trailer[0]) << 24 | uint32_t(trailer[1]) << 16 |
+                uint32_t(trailer[2]) << 8 | trailer[3];
+  }
+
+  if (numSegments_ == 1) {
+    // Share the received frame instead of copying it.
+    receivedData_ = PacketBuffer(payload.subView(0, length));
+  } else {
+    std::memcpy(receivedData_.getPtr() + offset, payload.getPtr(), length);
   }
+  // Fold the segment in at its position. Order of arrival does not matter.
+  receivedCrc_ ^= crc::crc32Shift(crc::crc32(payload.getPtr(), length),
+                                  numBytes_ - offset - length);
   curSegment_++;
+  receivedSegments_[index / 8] |= 1 << (index % 8);
 
   // Check if all segments are received
   if (curSegment_ == numSegments_) {
@@ -215,28 +358,27 @@ void TransportCallback::receivePacketCallback(
     // All segments are received. Reconstruct the data.
     VRBS_MSG("All segments received. \n");
 
-    receivedData_.clear();
-    TransportData data;
-
     // Check if the data is correct
-    uint8_t crc = Core::computeCrc(receivedData_, 0);
-    if (crc != checksum_ ||
+    if (receivedCrc_ != checksum_ ||
         numBytes_ != receivedData_.size()) { // Data is corrupt. Discard.
 
       LOG_MSG("Received data is corrupt. CRC rcv: %d, Expected: %d. Data "
               "length: %d. \n",
-              crc, checksum_, receivedData_.size());
-      receivedData_.clear();
+              receivedCrc_, checksum_, receivedData_.size());
+      receivedData_.reset();
     } else { // publish the data
 
+      TransportData data;
       data.dstAddress = header.dstAddress;
       data.dstPort = dstPort;
       data.srcAddress = header.srcAddress;
       data.srcPort = srcPort;
+      // Hand the buffer over. Subscribers share it instead of copying.
+      data.data = std::move(receivedData_);
       receiveTopic_.publish(data);
     }
 
-    checksum_ = curSegment_ = numBytes_ = numSegments_ = 0;
+    curSegment_ = numBytes_ = numSegments_ = 0;
   }
 }
 
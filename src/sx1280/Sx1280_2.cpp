@@ -28,6 +28,7 @@ uint8_t Datalink_SX1280_V2::moduleCount = 0;
 Datalink_SX1280_V2::Datalink_SX1280_V2(SX128XLT &sx1280Driver)
     : Core::Scheduler::Task("Datalink_SX1280_V2"), lora(sx1280Driver) {
   moduleId = moduleCount++;
+  txQueue.setCapacity(kTxQueueSize);
   Core::getSystemScheduler().addTask(*this);
   setPriority(1000);
 }
@@ -49,11 +50,11 @@ size_t Datalink_SX1280_V2::getMaxPacketSize() const {
 }
 
 bool Datalink_SX1280_V2::isChannelBlocked() const {
-  bool blocked = !txRxEnabled || txPendingSize > 0;
+  bool blocked = !txRxEnabled || txQueue.isFull(Priority::NORMAL);
 
   // if (blocked) {
-  //   Serial.printf("Channel is blocked. txRxEnabled=%d, txPendingSize=%d\n",
-  //                 (int)txRxEnabled, (int)txPendingSize);
+  //   Serial.printf("Channel is blocked. txRxEnabled=%d, txQueueFill=%d\n",
+  //                 (int)txRxEnabled, (int)txQueue.size());
   // }
   return blocked;
 }
@@ -61,7 +62,7 @@ bool Datalink_SX1280_V2::isChannelBlocked() const {
 bool Datalink_SX1280_V2::transmitDataframe(const DataPacket &dataframe) {
   // Serial.printf("[SX1280 %d] Request to transmit packet of size %d bytes\n",
   //               moduleId, (int)dataframe.payload.size());
-  if (isChannelBlocked()) {
+  if (!txRxEnabled) {
     return false;
   }
 
@@ -76,19 +77,63 @@ bool Datalink_SX1280_V2::transmitDataframe(const DataPacket &dataframe) {
     return false;
   }
 
-  auto scheduledTxTime =
-      dataframe.timestamp == 0 ? Core::NowNs() : dataframe.timestamp;
-
-  if (sxTxPendingSize == 0 &&
+  if (sxTxPendingSize == 0 && txQueue.size() == 0 &&
       (state == State::Idle || state == State::IdleReceive)) {
     prepareTx(dataframe.payload.getPtr(), dataframe.payload.size(),
-              scheduledTxTime);
-  } else {
-    memcpy(txBuffer, dataframe.payload.getPtr(), len);
-    txPendingSize = len;
-    pendingTxTime = scheduledTxTime;
+              dataframe.timestamp == 0 ? Core::NowNs() : dataframe.timestamp);
+    return true;
+  }
+
+  // The radio is busy. The frame is sent once the ones before it are done. A
+  // timestamp of 0 is kept, so it goes out right after them.
+  if (!txQueue.push(dataframe)) {
+#ifdef SX1280_DEBUG
+    Serial.printf("[SX1280 %d] TX queue full. Frame dropped\n", moduleId);
+#endif
+    txQueueCounters.dropped++;
+    return false;
+  }
+  countTxQueued();
+
+  return true;
+}
+
+bool Datalink_SX1280_V2::transmitDataframe(const PacketChain &dataframe) {
+  if (!txRxEnabled) {
+    return false;
+  }
+
+  if (dataframe.size() > getMaxPacketSize()) {
+#ifdef SX1280_DEBUG
+    Serial.printf("[SX1280 %d] Frame too large (%d > %d)\n", moduleId,
+                  (int)dataframe.size(), (int)getMaxPacketSize());
+#endif
+    return false;
+  }
+
+  // The fragments are only valid during this call. Copy them into the queue
+  // if the radio cannot take them right away.
+  if (sxTxPendingSize != 0 || txQueue.size() != 0 ||
+      !(state == State::Idle || state == State::IdleReceive)) {
+    if (!txQueue.begin(dataframe.priority, dataframe.size(),
+                       dataframe.timestamp)) {
+#ifdef SX1280_DEBUG
+      Serial.printf("[SX1280 %d] TX queue full. Frame dropped\n", moduleId);
+#endif
+      txQueueCounters.dropped++;
+      return false;
+    }
+    for (size_t i = 0; i < dataframe.getNumFragments(); i++) {
+      auto fragment = dataframe.getFragment(i);
+      txQueue.append(fragment.getPtr(), fragment.size());
+    }
+    txQueue.commit();
+    countTxQueued();
+    return true;
   }
 
+  prepareTx(dataframe,
+            dataframe.timestamp == 0 ? Core::NowNs() : dataframe.timestamp);
   return true;
 }
 
@@ -139,6 +184,19 @@ void Datalink_SX1280_V2::setTxMaxPower(int8_t maxTxPower) {
 
 void Datalink_SX1280_V2::setPAdbm(uint8_t paDbm) { paGain = paDbm; }
 
+void Datalink_SX1280_V2::setTxQueueDepth(size_t depth) {
+  txQueue.setCapacity(depth > kTxQueueSize ? kTxQueueSize : depth);
+}
+
+void Datalink_SX1280_V2::setTransmitScheduling(TransmitScheduling scheduling) {
+  txQueue.setScheduling(scheduling);
+}
+
+void Datalink_SX1280_V2::setPriorityWeight(Priority priority,
+                                           uint16_t weight) {
+  txQueue.setWeight(priority, weight);
+}
+
 void Datalink_SX1280_V2::setPacketMode(SX1280_PacketMode mode) {
   if (mode != packetMode) {
     packetMode = mode;
@@ -180,7 +238,7 @@ void Datalink_SX1280_V2::setStartReceive(bool enable) {
 void Datalink_SX1280_V2::setEnableTxRx(bool enable) {
   txRxEnabled = enable;
   // if (!txRxEnabled) {
-  //   txPendingSize = 0;
+  //   txQueue.clear();
   //   startIdle();
   // }
 }
@@ -263,7 +321,7 @@ void Datalink_SX1280_V2::taskCheck() {
   // bool txReady =
   //     isTxReady() && (state == State::Idle || state == State::IdleReceive);
   // bool txPrepare =
-  //     txPendingSize > 0 && sxTxPendingSize == 0 && (state !=
+  //     txQueue.size() > 0 && sxTxPendingSize == 0 && (state !=
   //     State::Receiving);
   // bool startRx = rxStartedFlag && state == State::Idle;
   // bool stopIdleRx = leaveRxFlag && state == State::IdleReceive;
@@ -296,6 +354,9 @@ void Datalink_SX1280_V2::taskCheck() {
 
   bool txSendTrig =
       isTxReady() && (state == State::Idle || state == State::IdleReceive);
+  // Queued frames are loaded once the radio is free, e.g. after leaving sleep.
+  bool txQueueTrig = txQueue.size() > 0 && sxTxPendingSize == 0 &&
+                     (state == State::Idle || state == State::IdleReceive);
   bool idleToRxIdle = rxStartedFlag && state == State::Idle;
 
   bool txTimeoutTrig = state == State::Transmitting && txStartTimestamp != 0 &&
@@ -313,8 +374,8 @@ void Datalink_SX1280_V2::taskCheck() {
 
   bool txRxTimeoutTrig = rxTxTimeout;
 
-  if (txSendTrig || idleToRxIdle || txDoneTrig || idleRxSafetyTrig ||
-      rxActiveTrig || txRxTimeoutTrig) {
+  if (txSendTrig || txQueueTrig || idleToRxIdle || txDoneTrig ||
+      idleRxSafetyTrig || rxActiveTrig || txRxTimeoutTrig) {
     // Serial.printf("[SX1280 %d] Triggers: txSendTrig=%d, idleToRxIdle=%d, "
     //               "txDoneTrig=%d, txTimeoutTrig=%d, "
     //               "idleRxTimeoutTrig=%d, rxActiveTrig=%d,
@@ -529,7 +590,14 @@ void Datalink_SX1280_V2::updateModParams() {
 
 void Datalink_SX1280_V2::prepareTx(const uint8_t *data, size_t size,
                                    int64_t txStart) {
+  PacketChain chain;
+  chain.append(data, size);
+  prepareTx(chain, txStart);
+}
+
+void Datalink_SX1280_V2::prepareTx(const PacketChain &chain, int64_t txStart) {
   txScheduledTime = txStart == 0 ? Core::NowNs() : txStart;
+  const size_t size = chain.size();
 
   switch (packetMode) {
   case SX1280_PacketMode::Limited: {
@@ -539,7 +607,7 @@ void Datalink_SX1280_V2::prepareTx(const uint8_t *data, size_t size,
     uint8_t lenByte = static_cast<uint8_t>(size);
     lora.startWriteSXBuffer(128);
     lora.writeBufferRaw(&lenByte, 1);
-    lora.writeBufferRaw(data, size);
+    writeChain(chain);
     // Pad remaining bytes with zeros.
     size_t padLen = fixedPacketLength - size;
     if (padLen > 0) {
@@ -554,7 +622,7 @@ void Datalink_SX1280_V2::prepareTx(const uint8_t *data, size_t size,
     // Write data padded to fixedPacketLength, no length prefix.
     sxTxPendingSize = fixedPacketLength;
     lora.startWriteSXBuffer(128);
-    lora.writeBufferRaw(data, size);
+    writeChain(chain);
     size_t padLen = fixedPacketLength - size;
     if (padLen > 0) {
       uint8_t zeros[padLen];
@@ -568,7 +636,7 @@ void Datalink_SX1280_V2::prepareTx(const uint8_t *data, size_t size,
   default: {
     sxTxPendingSize = size;
     lora.startWriteSXBuffer(128);
-    lora.writeBufferRaw(data, sxTxPendingSize);
+    writeChain(chain);
     lora.endWriteSXBuffer();
     lora.setPayloadLength(static_cast<uint8_t>(sxTxPendingSize));
     break;
@@ -589,11 +657,38 @@ void Datalink_SX1280_V2::prepareTx(const uint8_t *data, size_t size,
 
   lora.setTxParams(power, RAMP_TIME);
 
-  txPendingSize = 0;
-
   // Serial.printf("%.4f, Tx Prepared\n", Core::NOWSeconds());
 }
 
+void Datalink_SX1280_V2::writeChain(const PacketChain &chain) {
+  for (size_t i = 0; i < chain.getNumFragments(); i++) {
+    auto fragment = chain.getFragment(i);
+    lora.writeBufferRaw(fragment.getPtr(), fragment.size());
+  }
+}
+
+void Datalink_SX1280_V2::prepareTxPending() {
+  // The frame may wrap around the end of the queue storage. Both parts go to
+  // the radio without another copy.
+  txQueue.take();
+  PacketChain chain;
+  size_t offset = 0;
+  size_t partLen;
+  while (auto part = txQueue.peekTaken(offset, partLen)) {
+    chain.append(part, partLen);
+    offset += partLen;
+  }
+  prepareTx(chain, txQueue.takenTimestamp());
+  txQueue.release();
+}
+
+void Datalink_SX1280_V2::countTxQueued() {
+  txQueueCounters.queued++;
+  if (txQueue.size() > txQueueCounters.maxFill) {
+    txQueueCounters.maxFill = txQueue.size();
+  }
+}
+
 void Datalink_SX1280_V2::startTx() {
 
   updateModParams();
@@ -681,65 +776,79 @@ void Datalink_SX1280_V2::retrieveRxData() {
 
   lastRxSuccessTime = Core::NowNs();
 
-  receivedDataRSSI = receivedDataRSSI * 0.9 + lora.readPacketRSSI() * 0.1;
-  receivedDataSNR = receivedDataSNR * 0.8 + lora.readPacketSNR() * 0.2;
+  DataPacket packet;
+  packet.metadata.rssi = lora.readPacketRSSI();
+  packet.metadata.snr = lora.readPacketSNR();
+  packet.metadata.frequencyError = lora.getFrequencyErrorHz();
+  packet.metadata.channel = currentChannel;
+  packet.metadata.irqTimestamp = rxDoneTimestamp;
+  packet.metadata.valid = true;
+
+  receivedDataRSSI = receivedDataRSSI * 0.9 + packet.metadata.rssi * 0.1;
+  receivedDataSNR = receivedDataSNR * 0.8 + packet.metadata.snr * 0.2;
+
+  packet.payload.setPool(packetPool_);
 
   size_t otaLen;  // bytes read from radio buffer
   size_t userLen; // actual user payload length
+  bool stored;    // if the payload had storage and was read
 
   switch (packetMode) {
   case SX1280_PacketMode::Limited: {
     otaLen = fixedPacketLength + 1; // 1-byte length prefix + payload area
-    uint8_t buffer[otaLen];
+    stored = packet.payload.setSize(fixedPacketLength);
     lora.startReadSXBuffer(0);
-    lora.readBuffer(buffer, otaLen);
+    userLen = lora.readUint8(); // first byte is length prefix
+    if (stored) {
+      lora.readBuffer(packet.payload.getPtr(), fixedPacketLength);
+    }
     lora.endReadSXBuffer();
-    userLen = buffer[0]; // first byte is length prefix
     if (userLen > fixedPacketLength) {
       userLen = fixedPacketLength; // sanity clamp
     }
-    auto tOA = lora.getLoRaTimeOnAirMs(otaLen) * Core::MILLISECONDS;
-    auto packetRecvStartTime = rxDoneTimestamp - tOA;
-    DataPacket packet;
-    packet.timestamp = packetRecvStartTime;
-    packet.payload.setSize(userLen);
-    memcpy(packet.payload.getPtr(), buffer + 1, userLen);
-    receiveHandlers_.callHandlers(packet);
-    return;
+    break;
   }
   case SX1280_PacketMode::Fixed: {
     otaLen = fixedPacketLength;
     userLen = fixedPacketLength;
-    uint8_t buffer[otaLen];
-    lora.startReadSXBuffer(0);
-    lora.readBuffer(buffer, otaLen);
-    lora.endReadSXBuffer();
-    auto tOA = lora.getLoRaTimeOnAirMs(otaLen) * Core::MILLISECONDS;
-    auto packetRecvStartTime = rxDoneTimestamp - tOA;
-    DataPacket packet;
-    packet.timestamp = packetRecvStartTime;
-    packet.payload.setSize(userLen);
-    memcpy(packet.payload.getPtr(), buffer, userLen);
-    receiveHandlers_.callHandlers(packet);
-    return;
+    stored = packet.payload.setSize(userLen);
+    if (stored) {
+      lora.startReadSXBuffer(0);
+      lora.readBuffer(packet.payload.getPtr(), userLen);
+      lora.endReadSXBuffer();
+    }
+    break;
   }
   case SX1280_PacketMode::Dynamic:
   default: {
-    auto len = lora.readRXPacketL();
-    uint8_t buffer[len];
-    lora.startReadSXBuffer(0);
-    lora.readBuffer(buffer, len);
-    lora.endReadSXBuffer();
-    auto tOA = lora.getLoRaTimeOnAirMs(len) * Core::MILLISECONDS;
-    auto packetRecvStartTime = rxDoneTimestamp - tOA;
-    DataPacket packet;
-    packet.timestamp = packetRecvStartTime;
-    packet.payload.setSize(len);
-    memcpy(packet.payload.getPtr(), buffer, len);
-    receiveHandlers_.callHandlers(packet);
-    return;
+    otaLen = lora.readRXPacketL();
+    if (otaLen > kMaxFrameLength) {
+      otaLen = kMaxFrameLength; // Foreign or corrupt frame.
+    }
+    userLen = otaLen;
+    stored = packet.payload.setSize(userLen);
+    if (stored) {
+      lora.startReadSXBuffer(0);
+      lora.readBuffer(packet.payload.getPtr(), userLen);
+      lora.endReadSXBuffer();
+    }
+    break;
   }
   }
+
+  if (!stored) {
+#ifdef SX1280_DEBUG
+    Serial.printf("[SX1280 %d] No storage for frame. Dropped\n", moduleId);
+#endif
+    receiveCounters.noStorage++;
+    return;
+  }
+
+  receiveCounters.received++;
+  packet.payload.setSize(userLen);
+  auto tOA = lora.getLoRaTimeOnAirMs(otaLen) * Core::MILLISECONDS;
+  packet.timestamp = rxDoneTimestamp - tOA;
+  receiveHandlers_.callHandlers(packet);
 }
 
 void Datalink_SX1280_V2::updateReceiveState() {
@@ -767,8 +876,8 @@ void Datalink_SX1280_V2::updateReceiveState() {
 
   // After leaving RX, prepare+start any pending TX before entering IdleRx
   // to avoid a wasteful RX→STDBY round-trip.
-  if (txPendingSize > 0 && sxTxPendingSize == 0) {
-    prepareTx(txBuffer, txPendingSize, pendingTxTime);
+  if (txQueue.size() > 0 && sxTxPendingSize == 0) {
+    prepareTxPending();
   }
   if (isTxReady()) {
     startTx();
@@ -803,8 +912,8 @@ void Datalink_SX1280_V2::updateTransmitState() {
 
     // Prepare any buffered TX before deciding to enter RX — avoids a
     // wasteful RX entry that would immediately be aborted by prepareTx.
-    if (txPendingSize > 0) {
-      prepareTx(txBuffer, txPendingSize, pendingTxTime);
+    if (txQueue.size() > 0) {
+      prepareTxPending();
     }
     if (isTxReady()) {
       startTx();
@@ -819,8 +928,8 @@ void Datalink_SX1280_V2::updateTransmitState() {
 
 void Datalink_SX1280_V2::updateIdleRxState() {
 
-  if (txPendingSize > 0 && sxTxPendingSize == 0) {
-    prepareTx(txBuffer, txPendingSize, pendingTxTime);
+  if (txQueue.size() > 0 && sxTxPendingSize == 0) {
+    prepareTxPending();
   }
 
   if (leaveRxFlag || !txRxEnabled) {
@@ -857,8 +966,8 @@ void Datalink_SX1280_V2::updateIdleRxState() {
 void Datalink_SX1280_V2::updateIdleState() {
 
   // updateModParams();
-  if (txPendingSize > 0 && sxTxPendingSize == 0) {
-    prepareTx(txBuffer, txPendingSize, pendingTxTime);
+  if (txQueue.size() > 0 && sxTxPendingSize == 0) {
+    prepareTxPending();
   }
 
   if (isTxReady()) {
@@ -4,7 +4,9 @@
 
 namespace VCTR::network::datalink {
 
-Sx1280_Direct::Sx1280_Direct(SX128XLT &sx1280Driver) : lora(sx1280Driver) {}
+Sx1280_Direct::Sx1280_Direct(SX128XLT &sx1280Driver) : lora(sx1280Driver) {
+  lastRxPacket.payload.setPool(&getDefaultPacketPool());
+}
 
 bool Sx1280_Direct::configureRadio() {
   if (!lora.checkDevice()) {
@@ -80,6 +82,12 @@ uint32_t Sx1280_Direct::getTxPacketCount() const { return txPacketCount; }
 uint8_t *Sx1280_Direct::getTxBufferPtr() { return txBuffer; }
 uint8_t Sx1280_Direct::getTxBufferSize() const { return kMaxFrameLength; }
 
+void Sx1280_Direct::setPacketPool(PacketPool *pool) {
+  // Drop the current storage so the next packet is taken from the new pool.
+  lastRxPacket.payload = PacketBuffer();
+  lastRxPacket.payload.setPool(pool);
+}
+
 size_t Sx1280_Direct::getNumChannels() const { return kNumChannels; }
 
 size_t Sx1280_Direct::getCurrentChannel() const { return currentChannel; }
@@ -407,6 +415,12 @@ void Sx1280_Direct::readCompletedPacket() {
   receivedDataRSSI = lora.readPacketRSSI();
   receivedDataSNR = lora.readPacketSNR();
   lastRxPacket.timestamp = lastRxTimestamp;
+  lastRxPacket.metadata.rssi = receivedDataRSSI;
+  lastRxPacket.metadata.snr = receivedDataSNR;
+  lastRxPacket.metadata.frequencyError = lora.getFrequencyErrorHz();
+  lastRxPacket.metadata.channel = currentChannel;
+  lastRxPacket.metadata.irqTimestamp = lastRxTimestamp;
+  lastRxPacket.metadata.valid = true;
 
   if (packetMode == SX1280_PacketMode::Limited) {
     uint8_t buffer[kMaxFrameLength + 1] = {0};